@@ -1,67 +1,401 @@
 #include "AdjacencyList.h"
+#include "StringSort.h"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <map>
 #include <set>
+#include <fstream>
+#include <cstdio>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
 
 using namespace std;
 
+// checkpoint file header, bumped whenever the layout changes
+static const char CHECKPOINT_MAGIC[8] = {'P', 'R', 'C', 'K', 'P', 'T', '0', '1'};
+
+AdjacencyList::AdjacencyList(pmr::memory_resource* resource) : upstream(resource), pool(make_unique<pmr::unsynchronized_pool_resource>(resource)) {}
+
 int AdjacencyList::createID(const string& page) {
+    if (names_frozen) {
+        int found = names->find(page);
+        if (found != -1) return found;
+        thawNames();
+    }
+
     // if page doesn't exist, creates a new id
-    if (page_to_id.find(page) == page_to_id.end()) {
+    auto it = page_to_id.find(string_view(page));
+    if (it == page_to_id.end()) {
         int current_id = id++;
-        page_to_id[page] = current_id;
-        id_to_page[current_id] = page;
+        pages_version++;
+        auto stored = id_to_page.emplace(current_id, string_view(page)).first;
+        page_to_id.emplace(string_view(stored->second), current_id);
 
         return current_id;
     } else { // pages exists
-        return page_to_id[page];
+        return it->second;
     }
 }
 
 // creating edge with createID and adding to adjacency list
 void AdjacencyList::addEdge(const string& from_page, const string& to_page) {
-    int from_id = createID(from_page);
+    // page_to_id and names aren't written while ingesting concurrently, so every producer can read them
+    if (ingest) {
+        auto concurrentID = [this](const string& page) {
+            int page_id = findPage(page);
+            return page_id != -1 ? page_id : ingest->intern(page);
+        };
 
-    if (to_page.empty()) {
-        if (adj.find(from_id) == adj.end()) {
-            adj[from_id] = {};
+        int from_id = concurrentID(from_page);
+        if (!to_page.empty()) {
+            ingest->addLink(from_id, concurrentID(to_page));
         }
-    } else {
+        return;
+    }
+
+    int from_id = createID(from_page);
+
+    if (!to_page.empty()) {
         int to_id = createID(to_page);
-        adj[from_id].push_back(to_id);
+        new_links.push_back({from_id, to_id});
+    }
+}
+
+// pages are interned in the order given, then every link is appended like addEdge does
+void AdjacencyList::addEdges(const vector<string>& pages, const vector<pair<int, int>>& edges) {
+    vector<int> ids(pages.size());
+    for (size_t i = 0; i < pages.size(); ++i) {
+        ids[i] = createID(pages[i]);
+    }
+
+    new_links.reserve(new_links.size() + edges.size());
+    for (const auto& edge : edges) {
+        new_links.push_back({ids[edge.first], ids[edge.second]});
+    }
+}
+
+// frozen links are marked -1 and reclaimed on the next compact, links not frozen yet are erased right away
+void AdjacencyList::removeEdge(const string& from_page, const string& to_page) {
+    mergeIngest();
+    int from_id = findPage(from_page);
+    int to_id = findPage(to_page);
+    if (from_id == -1 || to_id == -1) return;
+
+    if (from_id < csr.nodes) {
+        unpackCSR();
+        for (int e = csr.offsets[from_id]; e < csr.offsets[from_id + 1]; ++e) {
+            if (csr.targets[e] == to_id) {
+                csr.targets[e] = -1;
+                removed_links++;
+            }
+        }
+    }
+
+    new_links.erase(std::remove(new_links.begin(), new_links.end(), make_pair(from_id, to_id)), new_links.end());
+}
+
+// tombstones the page and takes it out of the lookup. its name and every link from or to it stay until compact
+// renumbers the pages
+void AdjacencyList::removeNode(const string& page) {
+    mergeIngest();
+    thawNames();
+    auto it = page_to_id.find(string_view(page));
+    if (it == page_to_id.end()) return;
+
+    int page_id = it->second;
+    page_to_id.erase(it);
+    tombstones.insert(page_id);
+    pages_version++;
+}
+
+// one pass over everything: gives live pages new consecutive id's and drops removed links and links of removed pages
+void AdjacencyList::compact() {
+    mergeIngest();
+    if (tombstones.empty() && removed_links == 0) return;
+    if (tombstones.empty()) {
+        rebuildCSR(nullptr, nullptr);
+        return;
+    }
+
+    vector<int> new_ids(id, -1);
+    int live = 0;
+    for (int j = 0; j < id; ++j) {
+        if (tombstones.find(j) == tombstones.end()) {
+            new_ids[j] = live++;
+        }
     }
+
+    // names move over node by node, so the views in page_to_id keep pointing at them
+    pmr::map<int, pmr::string> new_id_to_page(pool.get());
+    pmr::map<int, double> new_ranks(pool.get());
+    vector<double> new_rank_values(rank_values.empty() ? 0 : live, -1.0);
+    for (int j = 0; j < id; ++j) {
+        int new_id = new_ids[j];
+        if (new_id == -1) continue;
+
+        auto node = id_to_page.extract(j);
+        node.key() = new_id;
+        page_to_id.find(string_view(node.mapped()))->second = new_id;
+        new_id_to_page.insert(move(node));
+
+        auto rank_it = ranks.find(j);
+        if (rank_it != ranks.end()) {
+            new_ranks[new_id] = rank_it->second;
+        }
+        if (j < static_cast<int>(rank_values.size())) {
+            new_rank_values[new_id] = rank_values[j];
+        }
+    }
+
+    rebuildCSR(&new_ids, nullptr);
+    id_to_page.swap(new_id_to_page);
+    ranks.swap(new_ranks);
+    rank_values.swap(new_rank_values);
+    tombstones.clear();
+    id = live;
+    pages_version++;
+
+    // the merged ingest is empty but would keep counting from the old numbering
+    if (ingest) ingest.reset(new ConcurrentIngest(id));
+}
+
+// frozen links first, then new ones, so every page keeps its links in the order they were added
+void AdjacencyList::rebuildCSR(const vector<int>* new_ids, CSRGraph* transposed) {
+    unpackCSR();
+
+    vector<pair<int, int>> links;
+    links.reserve(csr.targets.size() - removed_links + new_links.size());
+
+    auto keep = [&links, new_ids](int from, int to) {
+        if (new_ids != nullptr) {
+            from = (*new_ids)[from];
+            to = (*new_ids)[to];
+        }
+        if (from != -1 && to != -1) {
+            links.push_back({from, to});
+        }
+    };
+    for (int j = 0; j < csr.nodes; ++j) {
+        for (int e = csr.offsets[j]; e < csr.offsets[j + 1]; ++e) {
+            if (csr.targets[e] != -1) {
+                // weighted links are expanded again, the collapse below merges them with any new duplicates
+                for (int w = 0; w < csr.weight(e); ++w) {
+                    keep(j, csr.targets[e]);
+                }
+            }
+        }
+    }
+    for (const auto& link : new_links) {
+        keep(link.first, link.second);
+    }
+
+    int nodes = id;
+    if (new_ids != nullptr) {
+        nodes = static_cast<int>(count_if(new_ids->begin(), new_ids->end(), [](int new_id) { return new_id != -1; }));
+    }
+
+    csr = CSRGraph();
+    csr = buildCSR(nodes, links, threads, transposed);
+    if (collapse_duplicates) {
+        collapseDuplicates(csr, threads);
+        if (transposed != nullptr) {
+            collapseDuplicates(*transposed, threads);
+        }
+    }
+    csr_collapsed = collapse_duplicates;
+    new_links.clear();
+    new_links.shrink_to_fit();
+    removed_links = 0;
 }
 
-// calculates out degrees based off size of adjacency list at node_id
-map<int,double> AdjacencyList::calculateOutDegrees() const {
-    map<int, double> out_degrees;
-    int node_id;
+void AdjacencyList::updateCSR(CSRGraph* transposed) {
+    mergeIngest();
+    compact();
 
-    for (const auto& pair : adj) {
-        node_id = pair.first;
-        const auto& neighbor = pair.second;
-        out_degrees[node_id] = neighbor.size();
+    if (!new_links.empty() || csr.nodes != id || transposed != nullptr || csr_collapsed != collapse_duplicates) {
+        rebuildCSR(nullptr, transposed);
+    }
+
+    if (compress_links && !csr_packed) {
+        packed.encode(csr);
+        csr_packed = true;
+    } else if (!compress_links) {
+        unpackCSR();
+    }
+}
+
+void AdjacencyList::unpackCSR() {
+    if (!csr_packed) return;
+
+    packed.decode(csr);
+    packed = CompressedAdjacency();
+    csr_packed = false;
+}
+
+void AdjacencyList::setThreads(int count) {
+    threads = count;
+}
+
+void AdjacencyList::setCollapseDuplicates(bool collapse) {
+    collapse_duplicates = collapse;
+}
+
+void AdjacencyList::setCompressedStorage(bool compress) {
+    compress_links = compress;
+}
+
+void AdjacencyList::setConcurrentIngestion(bool enabled) {
+    if (enabled && !ingest) {
+        ingest.reset(new ConcurrentIngest(id));
+    } else if (!enabled && ingest) {
+        mergeIngest();
+        ingest.reset();
+    }
+}
+
+// pages come out in id order, so they line up with id_to_page's numbering. ingest stays on
+void AdjacencyList::mergeIngest() {
+    if (!ingest) return;
+
+    vector<pair<int, string>> pages = ingest->takePages();
+    if (!pages.empty()) thawNames(); // new names go into the maps
+    for (auto& id_page : pages) {
+        auto stored = id_to_page.emplace(id_page.first, string_view(id_page.second)).first;
+        page_to_id.emplace(string_view(stored->second), id_page.first);
+    }
+    if (id != ingest->nextID()) pages_version++;
+    id = ingest->nextID();
+
+    vector<pair<int, int>> links = ingest->takeLinks();
+    new_links.insert(new_links.end(), links.begin(), links.end());
+}
+
+// sorts the pages by name and renumbers everything in that order, then moves the names into the dictionary.
+// the pool holds nothing else afterwards (ranks are put back once it is empty), so it can return its memory.
+// concurrent ingestion stays as it is, pages it collected are merged first and producers find the frozen names
+void AdjacencyList::freezeNames() {
+    mergeIngest();
+    if (names_frozen) return;
+    compact();
+
+    vector<string_view> stored(id);
+    for (const auto& id_page : id_to_page) {
+        stored[id_page.first] = id_page.second;
+    }
+    vector<int> order = getAlphabeticalOrder();
+
+    vector<int> new_ids(id);
+    vector<string_view> sorted(id);
+    for (int i = 0; i < id; ++i) {
+        new_ids[order[i]] = i;
+        sorted[i] = stored[order[i]];
+    }
+    rebuildCSR(&new_ids, nullptr);
+    auto dictionary = make_shared<FrontCodedDictionary>();
+    dictionary->build(sorted);
+    names = move(dictionary);
+
+    vector<pair<int, double>> moved_ranks;
+    moved_ranks.reserve(ranks.size());
+    for (const auto& id_rank : ranks) {
+        moved_ranks.push_back({new_ids[id_rank.first], id_rank.second});
+    }
+    sort(moved_ranks.begin(), moved_ranks.end());
+    vector<double> new_rank_values(rank_values.empty() ? 0 : id, -1.0);
+    for (size_t j = 0; j < rank_values.size(); ++j) {
+        new_rank_values[new_ids[j]] = rank_values[j];
+    }
+
+    {
+        pmr::map<int, pmr::string> old_names(pool.get());
+        pmr::unordered_map<string_view, int> old_index(pool.get());
+        pmr::map<int, double> old_ranks(pool.get());
+        old_names.swap(id_to_page);
+        old_index.swap(page_to_id);
+        old_ranks.swap(ranks);
+    }
+    pool->release();
+
+    for (const auto& id_rank : moved_ranks) {
+        ranks.emplace_hint(ranks.end(), id_rank.first, id_rank.second);
+    }
+    rank_values.swap(new_rank_values);
+    names_frozen = true;
+    pages_version++;
+}
+
+// back to the maps, id's stay as they are
+void AdjacencyList::thawNames() {
+    if (!names_frozen) return;
+
+    page_to_id.reserve(names->size());
+    names->forEach([this](int page_id, const string& page) {
+        auto stored = id_to_page.emplace_hint(id_to_page.end(), page_id, string_view(page));
+        page_to_id.emplace(string_view(stored->second), page_id);
+    });
+    names.reset();
+    names_frozen = false;
+}
+
+int AdjacencyList::findPage(string_view page) const {
+    if (names_frozen) return names->find(page);
+
+    auto it = page_to_id.find(page);
+    return it == page_to_id.end() ? -1 : it->second;
+}
+
+pair<int, int> AdjacencyList::getPrefixRange(const string& prefix) {
+    freezeNames();
+    return names->prefixRange(prefix);
+}
+
+double AdjacencyList::getPrefixRank(const string& prefix) {
+    pair<int, int> range = getPrefixRange(prefix);
+    double total = 0.0;
+    for (int j = range.first; j < range.second && j < static_cast<int>(rank_values.size()); ++j) {
+        if (rank_values[j] >= 0.0) total += rank_values[j];
+    }
+    return total;
+}
+
+// calculates out degrees from every page's slice of csr, repeated links count every time
+RankMap AdjacencyList::calculateOutDegrees(pmr::memory_resource* scratch) const {
+    RankMap out_degrees(scratch);
+
+    for (int node_id = 0; node_id < csr.nodes; ++node_id) {
+        out_degrees[node_id] = csr.linkCount(node_id);
     }
 
     return out_degrees;
 }
 
 void AdjacencyList::calculatePageRank(int power_iterations) {
+    updateCSR(nullptr);
+    iterations_run = 0;
+
     int nodes = id;
-    if (nodes == 0) return;
+    if (nodes == 0) {
+        publishRanks();
+        return;
+    }
 
-    map<int, double> old_ranks;
-    map<int, double> out_degrees = calculateOutDegrees();
+    // everything below is released in one go when the run ends
+    pmr::monotonic_buffer_resource scratch(upstream);
+    RankMap old_ranks(&scratch);
+    RankMap older_ranks(&scratch); // the two iterates before old_ranks, for extrapolation
+    RankMap oldest_ranks(&scratch);
+    int history = 0; // iterates computed in a row this run, extrapolation needs four
+    RankMap out_degrees = calculateOutDegrees(&scratch);
 
     // for debugging adjacency list
     /*
     cout << "Adjacency List:" << endl;
-    for (const auto& [node_id, neighbors] : adj) {
+    for (int node_id = 0; node_id < nodes; ++node_id) {
         cout << "Node " << id_to_page.at(node_id) << " -> { ";
-        for (const auto& neighbor_id : neighbors) {
-            cout << "(" << id_to_page.at(neighbor_id) << " ";
+        for (int e = csr.offsets[node_id]; e < csr.offsets[node_id + 1]; ++e) {
+            cout << "(" << id_to_page.at(csr.targets[e]) << " ";
         }
         cout << "}" << endl;
     }
@@ -76,66 +410,498 @@ void AdjacencyList::calculatePageRank(int power_iterations) {
     }
     */
 
-    for (int p = 0; p < power_iterations; ++p) {
+    // resume from a checkpoint of this same graph if one is available. the graph doesn't change during the run,
+    // so its fingerprint is worked out once for the load and every save
+    int start = 0;
+    int saved_iteration = 0;
+    unsigned long long fingerprint = checkpoint_path.empty() ? 0 : graphFingerprint();
+    if (!checkpoint_path.empty() && loadCheckpoint(fingerprint, saved_iteration, old_ranks) &&
+        saved_iteration < power_iterations) {
+        start = saved_iteration + 1;
+        ranks = old_ranks;
+        if (start != power_iterations) {
+            for (int j = 0; j < nodes; ++j) {
+                ranks[j] = 0.0;
+            }
+        }
+        history = 1;
+        iterations_run = start;
+    }
+
+    bool save_pending = false;
+    for (int p = start; p < power_iterations; ++p) {
         if (p == 0) {
             // Initialize ranks to 1/n
             for (int j = 0; j < nodes; ++j) {
                 ranks[j] = 1.0 / nodes;
             }
-            old_ranks = ranks;
+        } else {
+            // rank sitting on pages with no out links, only used when damping
+            double dangling_mass = 0.0;
+
+            for (int j = 0; j < nodes; ++j) {
+                if (out_degrees[j] > 0 && csr_packed) {
+                    // same as below, links come out of the packed bytes 4 at a time
+                    packed.forEachTarget(csr, j, [&](int e, int k) {
+                        ranks[k] += csr.weight(e) * (old_ranks[j] / out_degrees[j]);
+                    });
+                } else if (out_degrees[j] > 0) {
+                    for (int e = csr.offsets[j]; e < csr.offsets[j + 1]; ++e) {
+                        int k = csr.targets[e];
+                        ranks[k] += csr.weight(e) * (old_ranks[j] / out_degrees[j]);
+                        //debugging calculation
+                        /*
+                        cout << "calculating for " << id_to_page.at(j)
+                                << " k=" << k
+                                << " j=" << j
+                                << " old_ranks[j]=" << old_ranks[j]
+                                << " out_degrees[j]=" << out_degrees[j]
+                                << " contribution of j to k rank += " << old_ranks[j] / out_degrees[j] << endl;
+                        */
+                    }
+                } else {
+                    dangling_mass += old_ranks[j];
+                }
+            }
 
-            if (p != power_iterations - 1) {
+            // teleport plus dangling share is the same for every page, so it is added once per page
+            if (damping_factor > 0.0) {
+                double base = (1.0 - damping_factor) / nodes + damping_factor * dangling_mass / nodes;
                 for (int j = 0; j < nodes; ++j) {
-                    ranks[j] = 0.0;
+                    ranks[j] = base + damping_factor * ranks[j];
                 }
             }
-            continue;
         }
+        history++;
+        bool last = p == power_iterations - 1;
 
-        for (int j = 0; j < nodes; ++j) {
-            if (out_degrees[j] > 0) {
-                for (const auto& k : adj[j]) {
-                    ranks[k] += old_ranks[j] / out_degrees[j];
-                    //debugging calculation
-                    /*
-                    cout << "calculating for " << id_to_page.at(j)
-                            << " k=" << k
-                            << " j=" << j
-                            << " old_ranks[j]=" << old_ranks[j]
-                            << " out_degrees[j]=" << out_degrees[j]
-                            << " contribution of j to k rank += " << old_ranks[j] / out_degrees[j] << endl;
-                    */
-                }
-            } else {
-                continue;
+        // converged, this iterate is the answer
+        if (tolerance > 0.0 && history >= 2) {
+            double change = 0.0;
+            for (int j = 0; j < nodes; ++j) {
+                change += fabs(ranks[j] - old_ranks[j]);
+            }
+            if (change < tolerance) {
+                last = true;
             }
         }
+
+        if (!last && extrapolation_interval > 0 && p % extrapolation_interval == 0 && history >= 4) {
+            extrapolate(ranks, old_ranks, older_ranks, oldest_ranks);
+        }
+
+        if (extrapolation_interval > 0) {
+            oldest_ranks.swap(older_ranks);
+            older_ranks.swap(old_ranks);
+        }
         old_ranks = ranks;
+        iterations_run = p + 1;
+
+        // save every checkpoint_interval iterations and after the last one. the two iterates right before an
+        // extrapolation are saved after it instead, since resuming from them would lose the history it needs.
+        // stopping on tolerance isn't saved either, a resumed run re-derives the same stopping point
+        if (!checkpoint_path.empty()) {
+            bool due = (p + 1) % checkpoint_interval == 0 || save_pending || p == power_iterations - 1;
+            bool before_extrapolation = extrapolation_interval > 0 &&
+                                        extrapolation_interval - p % extrapolation_interval < 3;
+            if (due && before_extrapolation) {
+                save_pending = true;
+            } else if (due && (!last || p == power_iterations - 1)) {
+                saveCheckpoint(fingerprint, p, old_ranks);
+                save_pending = false;
+            }
+        }
+
+        if (last) break;
+
         // if not at last iteration, reset the ranks
-        if (p != power_iterations - 1) {
-            for (int j = 0; j < nodes; ++j) {
+        for (int j = 0; j < nodes; ++j) {
 
-                ranks[j] = 0.0;
+            ranks[j] = 0.0;
+        }
+
+    }
+
+    publishRanks();
+}
+
+// builds the next snapshot next to the published one and swaps it in, readers holding the old one keep it
+// alive until they let go. live pages only, like getSortedRanks. the names are front coded, and once they
+// are frozen the snapshot shares the graph's own dictionary instead of holding a copy
+void AdjacencyList::publishRanks() {
+    if (!published_pages || published_pages_version != pages_version) {
+        vector<int> order;
+        if (names_frozen) {
+            // already alphabetical, and nothing is removed while the names are frozen
+            order.resize(names->size());
+            iota(order.begin(), order.end(), 0);
+            published_pages = names;
+        } else {
+            order = getAlphabeticalOrder();
+            vector<string_view> sorted;
+            sorted.reserve(order.size());
+            for (int page_id : order) {
+                sorted.push_back(id_to_page.at(page_id));
             }
+            auto pages = make_shared<FrontCodedDictionary>();
+            pages->build(sorted);
+            published_pages = move(pages);
+        }
+        published_order = move(order);
+        published_pages_version = pages_version;
+    }
+
+    vector<double> by_id(id, -1.0);
+    for (const auto& id_rank : ranks) {
+        if (id_rank.first < id) by_id[id_rank.first] = id_rank.second;
+    }
+
+    auto snapshot = make_shared<RankSnapshot>();
+    snapshot->version = ++published_version;
+    snapshot->pages = published_pages;
+    snapshot->ranks.resize(published_order.size());
+    for (size_t i = 0; i < published_order.size(); ++i) {
+        snapshot->ranks[i] = by_id[published_order[i]];
+    }
+
+    rank_snapshot.store(move(snapshot));
+    rank_values = move(by_id);
+}
+
+shared_ptr<const RankSnapshot> AdjacencyList::getRankSnapshot() const {
+    return rank_snapshot.load();
+}
+
+void AdjacencyList::setDampingFactor(double damping) {
+    damping_factor = damping;
+}
+
+void AdjacencyList::setTolerance(double l1_tolerance) {
+    tolerance = l1_tolerance;
+}
+
+void AdjacencyList::setExtrapolation(int interval) {
+    extrapolation_interval = interval > 0 ? max(interval, 4) : 0;
+}
+
+int AdjacencyList::getIterationsRun() const {
+    return iterations_run;
+}
+
+// quadratic extrapolation (Kamvar et al.), assumes the error in x0 is mostly made of the next three eigenvectors.
+// with y_i = x_i - x0, solve [y1 y2] g = -y3 by least squares, then x = (g1 + g2 + 1) x1 + (g2 + 1) x2 + x3,
+// scaled back to the old total rank
+void AdjacencyList::extrapolate(RankMap& x3, const RankMap& x2, const RankMap& x1, const RankMap& x0) const {
+    // normal equations of the 2 column least squares problem
+    double a11 = 0.0, a12 = 0.0, a22 = 0.0, b1 = 0.0, b2 = 0.0;
+    double total_before = 0.0;
+    for (const auto& id_rank : x3) {
+        int j = id_rank.first;
+        double y1 = x1.at(j) - x0.at(j);
+        double y2 = x2.at(j) - x0.at(j);
+        double y3 = id_rank.second - x0.at(j);
+        a11 += y1 * y1;
+        a12 += y1 * y2;
+        a22 += y2 * y2;
+        b1 -= y1 * y3;
+        b2 -= y2 * y3;
+        total_before += id_rank.second;
+    }
+
+    // already converged or the iterates are colinear, nothing to extrapolate from
+    double determinant = a11 * a22 - a12 * a12;
+    if (fabs(determinant) <= 1e-12 * a11 * a22) return;
+
+    double g1 = (b1 * a22 - b2 * a12) / determinant;
+    double g2 = (a11 * b2 - a12 * b1) / determinant;
+
+    double total_after = 0.0;
+    for (auto& id_rank : x3) {
+        int j = id_rank.first;
+        id_rank.second = (g1 + g2 + 1.0) * x1.at(j) + (g2 + 1.0) * x2.at(j) + id_rank.second;
+        total_after += id_rank.second;
+    }
+
+    if (total_after > 0.0) {
+        for (auto& id_rank : x3) {
+            id_rank.second *= total_before / total_after;
+        }
+    }
+}
+
+void AdjacencyList::setCheckpoint(const string& path, int interval) {
+    checkpoint_path = path;
+    checkpoint_interval = interval > 0 ? interval : 1;
+}
+
+// FNV-1a over page names, adjacency lists in id order and the options that change the iterates or where they stop,
+// needs a frozen graph
+unsigned long long AdjacencyList::graphFingerprint() const {
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    vector<int> targets;
+    for (int j = 0; j < id; ++j) {
+        string page = getPage(j);
+        mix(page.data(), page.size() + 1);
+
+        targets.clear();
+        if (csr_packed) {
+            packed.forEachTarget(csr, j, [&targets](int, int target) { targets.push_back(target); });
+        } else {
+            targets.assign(csr.targets.begin() + csr.offsets[j], csr.targets.begin() + csr.offsets[j + 1]);
+        }
+
+        int degree = csr.outDegree(j);
+        mix(&degree, sizeof(degree));
+        if (degree > 0) {
+            mix(targets.data(), degree * sizeof(int));
+            if (!csr.weights.empty()) {
+                mix(&csr.weights[csr.offsets[j]], degree * sizeof(int));
+            }
+        }
+    }
+    mix(&damping_factor, sizeof(damping_factor));
+    mix(&extrapolation_interval, sizeof(extrapolation_interval));
+    // a run without a tolerance may have saved iterates past where this one would already have stopped
+    mix(&tolerance, sizeof(tolerance));
+
+    return hash;
+}
+
+// reads the checkpoint, fails if it is missing, damaged or belongs to a different graph
+bool AdjacencyList::loadCheckpoint(unsigned long long fingerprint, int& iteration, RankMap& saved_ranks) const {
+    ifstream in(checkpoint_path, ios::binary);
+    if (!in) return false;
+
+    char magic[8];
+    unsigned long long saved_fingerprint = 0;
+    int nodes = 0;
+    int saved = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&saved_fingerprint), sizeof(saved_fingerprint));
+    in.read(reinterpret_cast<char*>(&nodes), sizeof(nodes));
+    in.read(reinterpret_cast<char*>(&saved), sizeof(saved));
+    if (!in || !equal(magic, magic + 8, CHECKPOINT_MAGIC) || saved_fingerprint != fingerprint || nodes != id) {
+        return false;
+    }
+
+    vector<double> values(nodes);
+    in.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(double));
+    if (!in || saved < 0) return false;
+
+    saved_ranks.clear();
+    for (int j = 0; j < nodes; ++j) {
+        saved_ranks[j] = values[j];
+    }
+    iteration = saved;
+    return true;
+}
+
+// writes to a temporary file first and renames it over the old checkpoint so a crash never leaves a partial file
+void AdjacencyList::saveCheckpoint(unsigned long long fingerprint, int iteration, const RankMap& saved_ranks) const {
+    string temp_path = checkpoint_path + ".tmp";
+    int nodes = id;
+
+    vector<double> values(nodes);
+    for (int j = 0; j < nodes; ++j) {
+        values[j] = saved_ranks.at(j);
+    }
+
+    {
+        ofstream out(temp_path, ios::binary | ios::trunc);
+        out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        out.write(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint));
+        out.write(reinterpret_cast<const char*>(&nodes), sizeof(nodes));
+        out.write(reinterpret_cast<const char*>(&iteration), sizeof(iteration));
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+        out.flush();
+        if (!out) {
+            cerr << "could not write checkpoint " << temp_path << endl;
+            return;
         }
+    }
 
+    if (rename(temp_path.c_str(), checkpoint_path.c_str()) != 0) {
+        cerr << "could not replace checkpoint " << checkpoint_path << endl;
+        remove(temp_path.c_str());
     }
 }
 
-// sort ranks alphabetically
+// sort ranks alphabetically: the ids are put in name order first, then the map is filled front to back
 map<string, double> AdjacencyList::getSortedRanks() const {
-    // automatically sorts strings alphabetically
     map<string, double> sorted_results;
 
-    // find page name using id_to_page for all matching id's and ranks in ranks and add to results map
-    for (const auto& id_rank : ranks) {
-        int page_id = id_rank.first;
-        double rank_score = id_rank.second;
+    // nothing was added, removed or renumbered since the last run published its names, so they are walked in
+    // the order publishRanks already sorted them into
+    if (published_pages && published_pages_version == pages_version) {
+        published_pages->forEach([&](int i, const string& page) {
+            double rank = rank_values[published_order[i]];
+            if (rank >= 0.0) {
+                sorted_results.emplace_hint(sorted_results.end(), page, rank);
+            }
+        });
+        return sorted_results;
+    }
 
-        string page_name = id_to_page.at(page_id);
+    // ranks and whether a page has one, by id. removed pages aren't in the order at all
+    vector<double> by_id(id, 0.0);
+    vector<bool> ranked(id, false);
+    for (const auto& id_rank : ranks) {
+        if (id_rank.first >= id) continue;
+        by_id[id_rank.first] = id_rank.second;
+        ranked[id_rank.first] = true;
+    }
 
-        sorted_results[page_name] = rank_score;
+    for (int page_id : getAlphabeticalOrder()) {
+        if (ranked[page_id]) {
+            sorted_results.emplace_hint(sorted_results.end(), getPage(page_id), by_id[page_id]);
+        }
     }
 
     return sorted_results;
 }
+
+// frozen names are numbered alphabetically already
+vector<int> AdjacencyList::getAlphabeticalOrder() const {
+    vector<int> order;
+    if (names_frozen) {
+        order.resize(id);
+        iota(order.begin(), order.end(), 0);
+        return order;
+    }
+
+    vector<string_view> stored(id);
+    for (const auto& id_page : id_to_page) {
+        stored[id_page.first] = id_page.second;
+        if (tombstones.find(id_page.first) == tombstones.end()) {
+            order.push_back(id_page.first);
+        }
+    }
+    sortByName(order, stored, threads);
+    return order;
+}
+
+// one hash lookup and one array read, nothing is allocated
+double AdjacencyList::getRank(const string& url) const {
+    int page_id = findPage(url);
+    if (page_id == -1 || page_id >= static_cast<int>(rank_values.size())) return -1.0;
+    return rank_values[page_id];
+}
+
+void AdjacencyList::getRanks(const string* urls, size_t count, double* out) const {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = getRank(urls[i]);
+    }
+}
+
+// everything is counted from what is allocated right now, the two transient entries are
+// what a calculatePageRank or getSortedRanks call on the current graph would add on top
+MemoryUsage AdjacencyList::getMemoryUsage() const {
+    MemoryUsage usage;
+    size_t pages = page_to_id.size();
+
+    // hash nodes hold the view, the id and the cached hash behind a next pointer
+    usage.interner = pages * heapBytes(sizeof(void*) + sizeof(pair<const string_view, int>) + sizeof(size_t)) +
+                     page_to_id.bucket_count() * sizeof(void*);
+
+    usage.names = id_to_page.size() * mapNodeBytes<int, pmr::string>() + (names ? names->byteSize() : 0);
+    if (published_pages && published_pages != names) {
+        usage.names += published_pages->byteSize();
+    }
+    for (const auto& id_page : id_to_page) {
+        usage.names += stringHeapBytes(id_page.second);
+    }
+
+    usage.adjacency = vectorHeapBytes(csr.offsets) + vectorHeapBytes(csr.targets) + vectorHeapBytes(csr.weights) +
+                      vectorHeapBytes(new_links) + (csr_packed ? packed.byteSize() : 0);
+    usage.ranks = ranks.size() * mapNodeBytes<int, double>() + vectorHeapBytes(rank_values) + vectorHeapBytes(published_order);
+    shared_ptr<const RankSnapshot> snapshot = getRankSnapshot();
+    if (snapshot) {
+        usage.ranks += vectorHeapBytes(snapshot->ranks);
+    }
+    usage.bookkeeping = tombstones.size() * heapBytes(32 + sizeof(int));
+
+    // old_ranks and out_degrees, two more iterates when extrapolating, the vector a checkpoint is written from
+    size_t rank_maps = 2 + (extrapolation_interval > 0 ? 2 : 0);
+    usage.rank_run = rank_maps * id * mapNodeBytes<int, double>() +
+                     (checkpoint_path.empty() ? 0 : heapBytes(id * sizeof(double)));
+    if (!new_links.empty() || removed_links > 0 || !tombstones.empty()) {
+        // freezing first holds the old links, a flat copy of them and the new csr at once
+        usage.rank_run += vectorHeapBytes(csr.targets) + (new_links.size() + csr.targets.size()) * (sizeof(pair<int, int>) + sizeof(int));
+    }
+
+    auto add_output = [&usage](int, const auto& page) {
+        usage.sorted_output += mapNodeBytes<string, double>() + heapBytes(page.size() + 1) * (page.size() > 15);
+    };
+    for (const auto& id_page : id_to_page) {
+        add_output(id_page.first, id_page.second);
+    }
+    if (names) names->forEach(add_output);
+
+    return usage;
+}
+
+// tries the representations cheapest first: merging repeated links costs nothing while ranking but adds
+// a weight per link, so it only pays off with enough repeats, packing costs decoding time. front coding the
+// names saves the most but renumbers the pages and makes every name lookup a search, so it comes last.
+// the first one that fits is kept, otherwise the smallest. ranks and id's have no smaller form in this
+// class, so they decide whether a budget is reachable at all
+bool AdjacencyList::fitMemoryBudget(size_t bytes) {
+    const bool options[4][2] = {{false, false}, {true, false}, {false, true}, {true, true}};
+    int tries = names_frozen ? 4 : 8;
+    int smallest = 0;
+    size_t smallest_peak = 0;
+    for (int o = 0; o < tries; ++o) {
+        if (o == 4) freezeNames();
+        setCollapseDuplicates(options[o % 4][0]);
+        setCompressedStorage(options[o % 4][1]);
+        updateCSR(nullptr);
+        size_t peak = getMemoryUsage().peak();
+        if (peak <= bytes) return true;
+        if (o == 0 || peak < smallest_peak) {
+            smallest = o;
+            smallest_peak = peak;
+        }
+    }
+    if (tries == 8 && smallest < 4) thawNames();
+    setCollapseDuplicates(options[smallest % 4][0]);
+    setCompressedStorage(options[smallest % 4][1]);
+    updateCSR(nullptr);
+    return false;
+}
+
+// compacts, then merges links added since the last freeze into csr. asking for the incoming links rebuilds
+// both in one pass. the copy handed out always has plain targets
+CSRGraph AdjacencyList::freeze(CSRGraph* transposed) {
+    updateCSR(transposed);
+
+    CSRGraph frozen = csr;
+    if (csr_packed) {
+        packed.decode(frozen);
+    }
+    return frozen;
+}
+
+int AdjacencyList::getNodeCount() const {
+    return id;
+}
+
+int AdjacencyList::getID(const string& page) const {
+    return findPage(page);
+}
+
+string AdjacencyList::getPage(int page_id) const {
+    if (names_frozen) {
+        string page;
+        names->get(page_id, page);
+        return page;
+    }
+    return string(id_to_page.at(page_id));
+}
@@ -3,29 +3,166 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <set>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include "CSRGraph.h"
+#include "CompressedAdjacency.h"
+#include "MemoryUsage.h"
+#include "ConcurrentIngest.h"
+#include "RankSnapshot.h"
+#include "FrontCodedDictionary.h"
 
 using namespace std;
 
+// rank maps of one calculatePageRank run, allocated from its scratch arena
+using RankMap = pmr::map<int, double>;
+
 class AdjacencyList {
 private:
     int id = 0;
 
-    // maps for page to id and id to page
-    map<string, int> page_to_id;
-    map<int, string> id_to_page;
+    // names, maps and ranks live in pool, which takes memory from upstream in large blocks
+    // and hands it all back at once when the graph goes away. it sits on the heap so a moved graph keeps it
+    pmr::memory_resource* upstream;
+    unique_ptr<pmr::unsynchronized_pool_resource> pool;
+
+    // maps for id to page and page to id. names are stored once, in id_to_page, and page_to_id hashes views of
+    // them. map nodes never move, so the views stay valid until the page itself goes
+    pmr::map<int, pmr::string> id_to_page{pool.get()};
+    pmr::unordered_map<string_view, int> page_to_id{pool.get()};
+
+    // after freezeNames both maps are empty and the names live here instead, id's in alphabetical order.
+    // adding a page that isn't there yet or removing one turns the maps back on. shared with rank snapshots
+    shared_ptr<const FrontCodedDictionary> names;
+    bool names_frozen = false;
+    void thawNames();
+    int findPage(string_view page) const; // id of page in either form, -1 if it isn't there
+
+    // adjacency list, new links wait in new_links until freeze() merges them into csr.
+    // removed links are marked -1 in csr until the next compact
+    CSRGraph csr;
+    vector<pair<int, int>> new_links;
+    int removed_links = 0;
+    int threads = 0; // for building csr, 0 uses every core
+    bool collapse_duplicates = false; // store repeated links once with a weight
+    bool csr_collapsed = false; // whether csr was built that way
+
+    // frozen targets can be kept delta encoded in packed instead of csr.targets, they are unpacked
+    // again whenever the links change
+    CompressedAdjacency packed;
+    bool compress_links = false;
+    bool csr_packed = false;
+
+    // ranks use id's as keys using createID
+    pmr::map<int, double> ranks{pool.get()};
+    vector<double> rank_values; // the same ranks by id once a run is done, -1 for pages it didn't rank
+
+    // id's of removed pages, kept until compact renumbers everything
+    pmr::set<int> tombstones{pool.get()};
+
+    // 0 keeps the original undamped iteration, otherwise rank of dangling pages is spread evenly
+    double damping_factor = 0.0;
+
+    // convergence options: stop once an iteration moves the ranks less than tolerance (L1),
+    // and apply quadratic extrapolation every extrapolation_interval iterations, 0 turns either off
+    double tolerance = 0.0;
+    int extrapolation_interval = 0;
+    int iterations_run = 0;
+
+    // the last published ranks, readers get them without locks and never see a run in progress. the sorted
+    // page names are rebuilt only when pages_version moved since they were made, frozen names are used as they are
+    RankSnapshotSlot rank_snapshot;
+    shared_ptr<const FrontCodedDictionary> published_pages;
+    vector<int> published_order; // id of every entry of published_pages
+    long long pages_version = 0; // bumped whenever pages are added, removed or renumbered
+    long long published_pages_version = -1;
+    long long published_version = 0;
+    void publishRanks();
+
+    // set while addEdge may be called from several threads, merged into the maps and new_links on the next freeze
+    unique_ptr<ConcurrentIngest> ingest;
+    void mergeIngest();
 
-    // adjacency list and ranks, each use id's as keys using createID
-    map<int, vector<int>> adj;
-    map<int, double> ranks;
+    // checkpoint file for long runs, disabled while the path is empty
+    string checkpoint_path;
+    int checkpoint_interval = 0;
 
-    map<int, double> calculateOutDegrees() const; // finds out degrees of every page
+    RankMap calculateOutDegrees(pmr::memory_resource* scratch) const; // finds out degrees of every page
 
     // creates id's and checks for duplicates id's
     int createID(const string& url);
 
+    // rebuilds csr from its live links plus new_links, new_ids renumbers pages (-1 drops them) when not null
+    void rebuildCSR(const vector<int>* new_ids, CSRGraph* transposed);
+    void updateCSR(CSRGraph* transposed); // compacts, merges new links and packs csr as configured
+    void unpackCSR();
+
+    // quadratic extrapolation from the last four iterates, x3 is the newest and gets overwritten
+    void extrapolate(RankMap& x3, const RankMap& x2, const RankMap& x1, const RankMap& x0) const;
+
+    // checkpointing helpers, the fingerprint ties a checkpoint to one graph snapshot
+    unsigned long long graphFingerprint() const;
+    bool loadCheckpoint(unsigned long long fingerprint, int& iteration, RankMap& saved_ranks) const;
+    void saveCheckpoint(unsigned long long fingerprint, int iteration, const RankMap& saved_ranks) const;
+
 
 public:
+    // every allocation of the graph goes to resource, temporaries of a run come from an arena on top of it
+    explicit AdjacencyList(pmr::memory_resource* resource = pmr::get_default_resource());
+
+    // moving hands the pool over together with the maps allocated from it, so the name views stay valid.
+    // copies and assignments are off: a pmr map keeps its pool for life, so the target's maps would have to
+    // copy every name into their own pool and rebuild page_to_id and the frozen state
+    AdjacencyList(AdjacencyList&& other) = default;
+    AdjacencyList(const AdjacencyList&) = delete;
+    AdjacencyList& operator=(const AdjacencyList&) = delete;
+    AdjacencyList& operator=(AdjacencyList&&) = delete;
+
     void calculatePageRank(int power_iterations); // does initial ranks, and then power iterations
+    void setDampingFactor(double damping); // e.g. 0.85, 0 turns damping off
+    void setTolerance(double l1_tolerance); // stop before power_iterations once ranks change less than this
+    void setExtrapolation(int interval); // quadratic extrapolation every interval (>= 4) iterations
+    int getIterationsRun() const; // iterations done by the last calculatePageRank, counting the initial one
+    void setCheckpoint(const string& path, int interval); // saves ranks every interval iterations and resumes from path
     void addEdge(const string& from_url, const string& to_url); // adds pages to adjacency list, uses createID
+    void addEdges(const vector<string>& pages, const vector<pair<int, int>>& edges); // bulk addEdge, edges index into pages
+    void removeEdge(const string& from_url, const string& to_url); // drops every from -> to link
+    void removeNode(const string& url); // tombstones the page, its links are dropped on the next compact
+    void compact(); // reclaims removed pages and links and renumbers id's, calculatePageRank does this automatically
+    void setThreads(int count); // threads used to build the csr and sort names, 0 uses every core
+    void setCollapseDuplicates(bool collapse); // repeated links become one weighted link on the next freeze
+    void setCompressedStorage(bool compress); // keep frozen links delta encoded, decoded on the fly while ranking
+
+    // while on, addEdge can be called from any number of threads at once, nothing else may run alongside it.
+    // pages added meanwhile show up in getID and friends after the next freeze, calculatePageRank or switching it off
+    void setConcurrentIngestion(bool enabled);
     map<string, double> getSortedRanks() const; // sorts ranks alphabetically, prepares for output
+    vector<int> getAlphabeticalOrder() const; // live page id's sorted by name, on setThreads threads
+
+    // rank of a page from the last run without copying anything, -1 if the page is unknown or wasn't ranked yet
+    double getRank(const string& url) const;
+    void getRanks(const string* urls, size_t count, double* out) const; // getRank for count urls at once
+
+    // ranks of the last finished calculatePageRank, safe to call and read from any thread while the graph is
+    // being changed or re-ranked. empty (null) before the first run
+    shared_ptr<const RankSnapshot> getRankSnapshot() const;
+
+    // memory accounting
+    MemoryUsage getMemoryUsage() const;
+    bool fitMemoryBudget(size_t bytes); // switches to smaller representations until the peak fits, false if none does
+
+    // read access for the other rank engines
+    CSRGraph freeze(CSRGraph* transposed = nullptr); // compacts, merges new links and returns a plain copy, can also build incoming links
+    int getNodeCount() const; // id's run from 0 to getNodeCount() - 1 after compacting
+    int getID(const string& url) const; // -1 if the page doesn't exist
+
+    // front coded names: renumbers pages alphabetically and keeps their names sorted and shared-prefix
+    // compressed, so everything under a prefix (a host, a directory) is one id range
+    void freezeNames();
+    pair<int, int> getPrefixRange(const string& prefix); // [first, last) id's starting with prefix, freezes the names first
+    double getPrefixRank(const string& prefix); // summed rank of those pages from the last run
+    string getPage(int page_id) const;
 };
\ No newline at end of file
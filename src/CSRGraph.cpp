@@ -0,0 +1,203 @@
+#include "CSRGraph.h"
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+// below this many links starting threads costs more than it saves
+static const size_t PARALLEL_EDGE_THRESHOLD = 1 << 16;
+
+// runs work(0) .. work(threads - 1), one on the calling thread
+static void runParallel(int threads, const function<void(int)>& work) {
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// stable counting sort of links by page into offsets and targets. each(t, emit) calls emit(page, target) for
+// every link of chunk t in order, chunks come in order too. every thread files its chunk by page range into
+// one shared buffer, then thread t sorts page range t alone, so a thread only counts the pages it owns:
+// besides the output that's one slot per link and threads * threads chunk totals, whatever the page count
+template <class Each>
+static void sortByPage(int nodes, size_t links, int threads, Each each, vector<int>& offsets, vector<int>& targets) {
+    auto range_begin = [nodes, threads](int r) { return static_cast<int>(static_cast<long long>(nodes) * r / threads); };
+    auto range_of = [&range_begin, nodes, threads](int u) {
+        int r = static_cast<int>(static_cast<long long>(u) * threads / nodes);
+        while (r + 1 < threads && u >= range_begin(r + 1)) r++;
+        while (u < range_begin(r)) r--;
+        return r;
+    };
+
+    // filed[t * threads + r] is how many links chunk t has for range r, then where it writes them
+    vector<size_t> filed(static_cast<size_t>(threads) * threads, 0);
+    runParallel(threads, [&](int t) {
+        size_t* totals = &filed[static_cast<size_t>(t) * threads];
+        each(t, [&](int u, int) { totals[range_of(u)]++; });
+    });
+
+    vector<size_t> range_start(threads + 1, 0);
+    size_t position = 0;
+    for (int r = 0; r < threads; ++r) {
+        range_start[r] = position;
+        for (int t = 0; t < threads; ++t) {
+            size_t count = filed[static_cast<size_t>(t) * threads + r];
+            filed[static_cast<size_t>(t) * threads + r] = position;
+            position += count;
+        }
+    }
+    range_start[threads] = position;
+
+    vector<pair<int, int>> buffer(links);
+    runParallel(threads, [&](int t) {
+        size_t* next = &filed[static_cast<size_t>(t) * threads];
+        each(t, [&](int u, int v) { buffer[next[range_of(u)]++] = {u, v}; });
+    });
+
+    offsets.assign(nodes + 1, 0);
+    targets.resize(links);
+    runParallel(threads, [&](int r) {
+        int first = range_begin(r);
+        int last = range_begin(r + 1);
+        vector<int> next(last - first, 0);
+        for (size_t i = range_start[r]; i < range_start[r + 1]; ++i) {
+            next[buffer[i].first - first]++;
+        }
+        int running = static_cast<int>(range_start[r]);
+        for (int u = first; u < last; ++u) {
+            offsets[u] = running;
+            int count = next[u - first];
+            next[u - first] = running;
+            running += count;
+        }
+        for (size_t i = range_start[r]; i < range_start[r + 1]; ++i) {
+            targets[next[buffer[i].first - first]++] = buffer[i].second;
+        }
+    });
+    offsets[nodes] = static_cast<int>(links);
+}
+
+// edges are split into one chunk per thread and sorted by sortByPage, chunk order keeps each page's links in
+// input order. the transposed graph is sorted the same way from the finished csr, chunks being ranges of source
+// pages, so incoming links always come in source order however edges was ordered
+CSRGraph buildCSR(int nodes, const vector<pair<int, int>>& edges, int threads, CSRGraph* transposed) {
+    if (threads <= 0) {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    if (edges.size() < PARALLEL_EDGE_THRESHOLD) {
+        threads = 1;
+    }
+
+    auto chunk_begin = [&edges, threads](int t) { return edges.size() * t / threads; };
+
+    CSRGraph csr;
+    csr.nodes = nodes;
+    sortByPage(nodes, edges.size(), threads, [&](int t, auto emit) {
+        for (size_t e = chunk_begin(t); e < chunk_begin(t + 1); ++e) {
+            emit(edges[e].first, edges[e].second);
+        }
+    }, csr.offsets, csr.targets);
+
+    if (transposed != nullptr) {
+        // source ranges with about the same number of links each
+        vector<int> source_begin(threads + 1, nodes);
+        for (int t = 0; t < threads; ++t) {
+            int links = static_cast<int>(edges.size() * t / threads);
+            source_begin[t] = static_cast<int>(lower_bound(csr.offsets.begin(), csr.offsets.end() - 1, links) - csr.offsets.begin());
+        }
+
+        transposed->nodes = nodes;
+        sortByPage(nodes, edges.size(), threads, [&](int t, auto emit) {
+            for (int u = source_begin[t]; u < source_begin[t + 1]; ++u) {
+                for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; ++e) {
+                    emit(csr.targets[e], u);
+                }
+            }
+        }, transposed->offsets, transposed->targets);
+    }
+
+    return csr;
+}
+
+int CSRGraph::linkCount(int u) const {
+    if (weights.empty()) return outDegree(u);
+
+    int links = 0;
+    for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+        links += weights[e];
+    }
+    return links;
+}
+
+// 1. every thread sorts the slices of its range of pages and counts the distinct targets
+// 2. offsets of the collapsed graph from a prefix sum of those counts
+// 3. every thread writes its pages' distinct targets and how often each one appeared
+void collapseDuplicates(CSRGraph& csr, int threads) {
+    if (threads <= 0) {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    if (csr.targets.size() < PARALLEL_EDGE_THRESHOLD) {
+        threads = 1;
+    }
+
+    int nodes = csr.nodes;
+    auto range_begin = [nodes, threads](int t) { return static_cast<int>(static_cast<long long>(nodes) * t / threads); };
+    bool had_weights = !csr.weights.empty();
+
+    vector<int> distinct(nodes + 1, 0);
+    runParallel(threads, [&](int t) {
+        for (int u = range_begin(t); u < range_begin(t + 1); ++u) {
+            auto first = csr.targets.begin() + csr.offsets[u];
+            auto last = csr.targets.begin() + csr.offsets[u + 1];
+            if (had_weights) {
+                // already collapsed once, sorting targets alone would lose which weight goes where
+                vector<pair<int, int>> links;
+                for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; ++e) {
+                    links.push_back({csr.targets[e], csr.weights[e]});
+                }
+                sort(links.begin(), links.end());
+                for (size_t i = 0; i < links.size(); ++i) {
+                    csr.targets[csr.offsets[u] + i] = links[i].first;
+                    csr.weights[csr.offsets[u] + i] = links[i].second;
+                }
+            } else {
+                sort(first, last);
+            }
+
+            int count = 0;
+            for (auto it = first; it != last; ++it) {
+                if (it == first || *it != *(it - 1)) count++;
+            }
+            distinct[u + 1] = count;
+        }
+    });
+
+    for (int u = 0; u < nodes; ++u) {
+        distinct[u + 1] += distinct[u];
+    }
+
+    vector<int> targets(distinct[nodes]);
+    vector<int> weights(distinct[nodes]);
+    runParallel(threads, [&](int t) {
+        for (int u = range_begin(t); u < range_begin(t + 1); ++u) {
+            int out = distinct[u] - 1;
+            for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; ++e) {
+                if (e == csr.offsets[u] || csr.targets[e] != csr.targets[e - 1]) {
+                    out++;
+                    targets[out] = csr.targets[e];
+                    weights[out] = 0;
+                }
+                weights[out] += had_weights ? csr.weights[e] : 1;
+            }
+        }
+    });
+
+    csr.offsets.swap(distinct);
+    csr.targets.swap(targets);
+    csr.weights.swap(weights);
+}
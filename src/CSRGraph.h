@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+// frozen compressed sparse row copy of the adjacency list, out links of page u are
+// targets[offsets[u]] .. targets[offsets[u + 1] - 1]
+struct CSRGraph {
+    int nodes = 0;
+    vector<int> offsets; // nodes + 1 entries
+    vector<int> targets;
+    vector<int> weights; // times each link was added after collapseDuplicates, empty means 1 each
+
+    int outDegree(int u) const { return offsets[u + 1] - offsets[u]; } // distinct entries
+    int weight(int e) const { return weights.empty() ? 1 : weights[e]; }
+    int linkCount(int u) const; // out links counting duplicates, what the rank is split by
+};
+
+// counting sort of (from, to) pairs into CSR on several threads (0 = every core). links of each page keep
+// the order they have in edges. if transposed isn't null it gets every page's incoming links sorted by source
+CSRGraph buildCSR(int nodes, const vector<pair<int, int>>& edges, int threads = 0, CSRGraph* transposed = nullptr);
+
+// sorts every page's links and merges repeats into one link with a weight
+void collapseDuplicates(CSRGraph& csr, int threads = 0);
@@ -0,0 +1,111 @@
+#include "CompressedAdjacency.h"
+#include <algorithm>
+
+using namespace std;
+
+// bytes a decoder may read past the last link, one full 16 byte load
+static const size_t PADDING = 16;
+
+#if defined(SSSE3_DECODER)
+// for every control byte, lane l takes its 1 - 4 bytes in order and zeroes the rest (0x80)
+namespace {
+struct ShuffleTable {
+    unsigned char masks[256 * 16];
+
+    ShuffleTable() {
+        for (int control = 0; control < 256; ++control) {
+            int source = 0;
+            for (int l = 0; l < 4; ++l) {
+                int length = ((control >> (2 * l)) & 3) + 1;
+                for (int b = 0; b < 4; ++b) {
+                    masks[16 * control + 4 * l + b] = b < length ? static_cast<unsigned char>(source++) : 0x80;
+                }
+            }
+        }
+    }
+};
+}
+
+const unsigned char* CompressedAdjacency::shuffleTable() {
+    static const ShuffleTable table;
+    return table.masks;
+}
+#endif
+
+bool CompressedAdjacency::simdSupported() {
+#if defined(SSSE3_DECODER)
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void CompressedAdjacency::setSimdDecoding(bool enabled) {
+    simd = enabled && simdSupported();
+}
+
+bool CompressedAdjacency::getSimdDecoding() const {
+    return simd;
+}
+
+void CompressedAdjacency::encode(CSRGraph& csr) {
+    int nodes = csr.nodes;
+    starts.assign(nodes + 1, 0);
+    bytes.clear();
+    bytes.reserve(csr.targets.size() + csr.targets.size() / 4 + PADDING);
+
+    vector<pair<int, int>> links;
+    for (int u = 0; u < nodes; ++u) {
+        int first = csr.offsets[u];
+        int count = csr.offsets[u + 1] - first;
+        starts[u] = bytes.size();
+
+        // sorted, weights moved along with their targets
+        if (csr.weights.empty()) {
+            sort(csr.targets.begin() + first, csr.targets.begin() + first + count);
+        } else {
+            links.clear();
+            for (int e = first; e < first + count; ++e) {
+                links.push_back({csr.targets[e], csr.weights[e]});
+            }
+            sort(links.begin(), links.end());
+            for (int i = 0; i < count; ++i) {
+                csr.targets[first + i] = links[i].first;
+                csr.weights[first + i] = links[i].second;
+            }
+        }
+
+        size_t control_start = bytes.size();
+        bytes.resize(bytes.size() + (count + 3) / 4, 0);
+
+        int previous = 0;
+        for (int i = 0; i < count; ++i) {
+            unsigned int delta = static_cast<unsigned int>(csr.targets[first + i] - previous);
+            previous = csr.targets[first + i];
+
+            int length = delta < (1u << 8) ? 1 : delta < (1u << 16) ? 2 : delta < (1u << 24) ? 3 : 4;
+            bytes[control_start + i / 4] |= static_cast<unsigned char>((length - 1) << (2 * (i % 4)));
+            for (int b = 0; b < length; ++b) {
+                bytes.push_back(static_cast<unsigned char>(delta >> (8 * b)));
+            }
+        }
+    }
+    starts[nodes] = bytes.size();
+    bytes.resize(bytes.size() + PADDING, 0);
+    bytes.shrink_to_fit();
+
+    csr.targets.clear();
+    csr.targets.shrink_to_fit();
+}
+
+void CompressedAdjacency::decode(CSRGraph& csr) const {
+    csr.targets.assign(csr.offsets[csr.nodes], 0);
+    for (int u = 0; u < csr.nodes; ++u) {
+        forEachTarget(csr, u, [&csr](int e, int target) { csr.targets[e] = target; });
+    }
+}
+
+size_t CompressedAdjacency::byteSize() const {
+    return bytes.size() + starts.size() * sizeof(size_t);
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "CSRGraph.h"
+
+// the pshufb decoder is built on x86 whatever the compile flags and picked at run time if the cpu has SSSE3
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SSSE3_DECODER 1
+#include <tmmintrin.h>
+#endif
+
+using namespace std;
+
+// targets of a CSRGraph sorted per page, delta encoded and packed with stream vbyte: for every 4 links one
+// control byte holds 4 two bit lengths (1 - 4 bytes), the data bytes follow the page's control bytes.
+// offsets and weights stay in the CSRGraph, link e of page u is still csr.offsets[u] + i
+class CompressedAdjacency {
+private:
+    vector<size_t> starts; // where every page's control bytes begin, nodes + 1 entries
+    vector<unsigned char> bytes; // padded so a 16 byte load past the last link stays inside
+
+    bool simd = simdSupported(); // decode with pshufb
+
+    // 4 links with control byte control, returns the data bytes used
+    static size_t decodeGroup(unsigned char control, const unsigned char* data, int previous, int* out);
+
+    // the loop is written out for each decoder, so the pshufb one is inlined into code built for SSSE3
+    template <class Visit>
+    void forEachTargetScalar(const CSRGraph& csr, int u, Visit visit) const {
+        int first = csr.offsets[u];
+        int count = csr.offsets[u + 1] - first;
+        const unsigned char* control = &bytes[starts[u]];
+        const unsigned char* data = control + (count + 3) / 4;
+
+        int decoded[4];
+        int previous = 0;
+        for (int i = 0; i < count; i += 4) {
+            data += decodeGroup(control[i / 4], data, previous, decoded);
+            int in_group = count - i < 4 ? count - i : 4;
+            for (int l = 0; l < in_group; ++l) {
+                visit(first + i + l, decoded[l]);
+            }
+            previous = decoded[3];
+        }
+    }
+
+#if defined(SSSE3_DECODER)
+    static const unsigned char* shuffleTable(); // pshufb mask for every control byte
+
+    __attribute__((target("ssse3")))
+    static size_t decodeGroupSSSE3(unsigned char control, const unsigned char* data, int previous, int* out);
+
+    template <class Visit>
+    __attribute__((target("ssse3")))
+    void forEachTargetSSSE3(const CSRGraph& csr, int u, Visit visit) const {
+        int first = csr.offsets[u];
+        int count = csr.offsets[u + 1] - first;
+        const unsigned char* control = &bytes[starts[u]];
+        const unsigned char* data = control + (count + 3) / 4;
+
+        int decoded[4];
+        int previous = 0;
+        for (int i = 0; i < count; i += 4) {
+            data += decodeGroupSSSE3(control[i / 4], data, previous, decoded);
+            int in_group = count - i < 4 ? count - i : 4;
+            for (int l = 0; l < in_group; ++l) {
+                visit(first + i + l, decoded[l]);
+            }
+            previous = decoded[3];
+        }
+    }
+#endif
+
+public:
+    void encode(CSRGraph& csr); // sorts csr's slices (weights too), packs the targets and frees csr.targets
+    void decode(CSRGraph& csr) const; // unpacks the targets back into csr.targets
+    size_t byteSize() const;
+
+    static bool simdSupported(); // built with the pshufb decoder and running on a cpu with SSSE3
+    void setSimdDecoding(bool enabled); // on by default where supported, tests turn it off to check the scalar path
+    bool getSimdDecoding() const;
+
+    // calls visit(e, target) for every link of u in sorted order, decoding 4 links at a time
+    template <class Visit>
+    void forEachTarget(const CSRGraph& csr, int u, Visit visit) const {
+#if defined(SSSE3_DECODER)
+        if (simd) {
+            forEachTargetSSSE3(csr, u, visit);
+            return;
+        }
+#endif
+        forEachTargetScalar(csr, u, visit);
+    }
+};
+
+inline size_t CompressedAdjacency::decodeGroup(unsigned char control, const unsigned char* data, int previous, int* out) {
+    size_t used = 0;
+    for (int l = 0; l < 4; ++l) {
+        int length = ((control >> (2 * l)) & 3) + 1;
+        unsigned int delta = 0;
+        for (int b = 0; b < length; ++b) {
+            delta |= static_cast<unsigned int>(data[used + b]) << (8 * b);
+        }
+        used += length;
+        previous += static_cast<int>(delta);
+        out[l] = previous;
+    }
+    return used;
+}
+
+#if defined(SSSE3_DECODER)
+// pshufb spreads the packed bytes into 4 lanes, two shifted adds turn the deltas into a running sum
+__attribute__((target("ssse3")))
+inline size_t CompressedAdjacency::decodeGroupSSSE3(unsigned char control, const unsigned char* data, int previous, int* out) {
+    static const unsigned char* table = shuffleTable();
+    __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16 * control));
+    __m128i deltas = _mm_shuffle_epi8(packed, mask);
+    deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+    deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+    deltas = _mm_add_epi32(deltas, _mm_set1_epi32(previous));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), deltas);
+    return 4 + (control & 3) + ((control >> 2) & 3) + ((control >> 4) & 3) + (control >> 6);
+}
+#endif
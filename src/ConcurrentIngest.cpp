@@ -0,0 +1,90 @@
+#include "ConcurrentIngest.h"
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+static atomic<long long> ingest_generations{0};
+
+ConcurrentIngest::ConcurrentIngest(int first_id, int stripe_count)
+    : stripes(max(stripe_count, 1)), next_id(first_id), generation(ingest_generations++) {}
+
+int ConcurrentIngest::intern(const string& page) {
+    Stripe& stripe = stripes[hash<string>()(page) % stripes.size()];
+    lock_guard<mutex> guard(stripe.lock);
+
+    auto it = stripe.ids.find(page);
+    if (it != stripe.ids.end()) return it->second;
+
+    int page_id = next_id++;
+    stripe.ids.emplace(page, page_id);
+    return page_id;
+}
+
+// ingests a thread keeps the buffer of at hand, for threads feeding several graphs in turn
+static const size_t CACHED_INGESTS = 8;
+
+// a thread remembers its buffers of the last few ingests it added to, by generation. anything older is found
+// again in the ingest's own table, so a thread never gets a second buffer in the same ingest
+ConcurrentIngest::LinkBuffer& ConcurrentIngest::localBuffer() {
+    thread_local vector<pair<long long, LinkBuffer*>> cached;
+    for (size_t i = 0; i < cached.size(); ++i) {
+        if (cached[i].first == generation) return *cached[i].second;
+    }
+
+    LinkBuffer* buffer;
+    {
+        lock_guard<mutex> guard(buffers_lock);
+        LinkBuffer*& registered = thread_buffers[this_thread::get_id()];
+        if (registered == nullptr) {
+            buffers.emplace_back(new LinkBuffer());
+            registered = buffers.back().get();
+        }
+        buffer = registered;
+    }
+
+    // most recent first, the oldest falls off the end
+    if (cached.size() == CACHED_INGESTS) cached.pop_back();
+    cached.insert(cached.begin(), {generation, buffer});
+    return *buffer;
+}
+
+void ConcurrentIngest::addLink(int from_id, int to_id) {
+    localBuffer().links.push_back({from_id, to_id});
+}
+
+vector<pair<int, string>> ConcurrentIngest::takePages() {
+    vector<pair<int, string>> pages;
+    for (Stripe& stripe : stripes) {
+        for (auto& page_id : stripe.ids) {
+            pages.push_back({page_id.second, page_id.first});
+        }
+        stripe.ids.clear();
+    }
+    sort(pages.begin(), pages.end());
+    return pages;
+}
+
+// buffers stay registered, their threads keep appending to them after a take
+vector<pair<int, int>> ConcurrentIngest::takeLinks() {
+    size_t total = 0;
+    for (const auto& buffer : buffers) {
+        total += buffer->links.size();
+    }
+
+    vector<pair<int, int>> links;
+    links.reserve(total);
+    for (auto& buffer : buffers) {
+        links.insert(links.end(), buffer->links.begin(), buffer->links.end());
+        buffer->links.clear();
+    }
+    return links;
+}
+
+int ConcurrentIngest::nextID() const {
+    return next_id;
+}
+
+int ConcurrentIngest::bufferCount() const {
+    return static_cast<int>(buffers.size());
+}
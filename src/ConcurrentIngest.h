@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+// what AdjacencyList collects while addEdge is called from several threads at once. pages are interned in
+// stripes, each behind its own lock, and get id's from one counter. links go to a buffer per thread, so
+// appending never waits on another producer. everything is handed over in one go when the graph freezes
+class ConcurrentIngest {
+private:
+    struct alignas(64) Stripe {
+        mutex lock;
+        unordered_map<string, int> ids;
+    };
+
+    struct alignas(64) LinkBuffer {
+        vector<pair<int, int>> links;
+    };
+
+    vector<Stripe> stripes;
+    atomic<int> next_id;
+    long long generation; // tells this object apart from earlier ones at the same address
+
+    mutex buffers_lock;
+    vector<unique_ptr<LinkBuffer>> buffers;
+    unordered_map<thread::id, LinkBuffer*> thread_buffers; // one buffer per producer thread
+
+    LinkBuffer& localBuffer(); // the calling thread's buffer, registered on first use
+
+public:
+    ConcurrentIngest(int first_id, int stripe_count = 64);
+
+    int intern(const string& page); // id of page, new pages count up from first_id
+    void addLink(int from_id, int to_id);
+
+    // everything collected so far, pages in id order, and the first id still free. not thread safe
+    vector<pair<int, string>> takePages();
+    vector<pair<int, int>> takeLinks();
+    int nextID() const;
+    int bufferCount() const; // link buffers registered, one per thread that added links
+};
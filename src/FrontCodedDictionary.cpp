@@ -0,0 +1,135 @@
+#include "FrontCodedDictionary.h"
+#include <algorithm>
+
+using namespace std;
+
+static void putVarint(vector<unsigned char>& out, size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+static size_t getVarint(const vector<unsigned char>& in, size_t& pos) {
+    size_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char byte = in[pos++];
+        value |= static_cast<size_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) return value;
+    }
+}
+
+void FrontCodedDictionary::build(const vector<string_view>& sorted) {
+    bytes.clear();
+    block_starts.clear();
+    count = static_cast<int>(sorted.size());
+
+    for (int id = 0; id < count; ++id) {
+        string_view name = sorted[id];
+        size_t shared = 0;
+        if (id % BLOCK == 0) {
+            block_starts.push_back(bytes.size());
+        } else {
+            string_view previous = sorted[id - 1];
+            size_t limit = min(previous.size(), name.size());
+            while (shared < limit && previous[shared] == name[shared]) shared++;
+            putVarint(bytes, shared);
+        }
+        putVarint(bytes, name.size() - shared);
+        bytes.insert(bytes.end(), name.begin() + shared, name.end());
+    }
+
+    bytes.shrink_to_fit();
+    block_starts.shrink_to_fit();
+}
+
+int FrontCodedDictionary::size() const {
+    return count;
+}
+
+string_view FrontCodedDictionary::blockHead(int block) const {
+    size_t pos = block_starts[block];
+    size_t length = getVarint(bytes, pos);
+    return string_view(reinterpret_cast<const char*>(&bytes[pos]), length);
+}
+
+// binary search for the last block whose head isn't greater than name, then a walk through that block.
+// the walk never rebuilds a string: it keeps how many leading bytes the previous string shares with name,
+// and a string sharing more or fewer bytes with its predecessor than that is decided without reading it
+int FrontCodedDictionary::lowerBound(string_view name, bool* exact) const {
+    if (exact != nullptr) *exact = false;
+    int blocks = static_cast<int>(block_starts.size());
+    int low = 0, high = blocks;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (blockHead(middle) <= name) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0) return 0;
+
+    int block = low - 1;
+    size_t pos = block_starts[block];
+    size_t matched = 0; // bytes the previous string has in common with name, which it is smaller than
+    int last = min(count, (block + 1) * BLOCK);
+    for (int id = block * BLOCK; id < last; ++id) {
+        size_t shared = id % BLOCK == 0 ? 0 : getVarint(bytes, pos);
+        size_t rest = getVarint(bytes, pos);
+        const char* suffix = reinterpret_cast<const char*>(&bytes[pos]);
+        pos += rest;
+
+        // more in common with the previous string than name has: same first differing byte, still smaller.
+        // less: this string's next byte is above the previous string's, which was name's byte there
+        if (shared > matched) continue;
+        if (shared < matched) return id;
+
+        size_t k = 0;
+        while (k < rest && matched + k < name.size() && suffix[k] == name[matched + k]) k++;
+        matched += k;
+        if (matched == name.size()) {
+            if (exact != nullptr) *exact = k == rest;
+            return id;
+        }
+        if (k < rest && static_cast<unsigned char>(suffix[k]) > static_cast<unsigned char>(name[matched])) return id;
+    }
+    return last;
+}
+
+int FrontCodedDictionary::find(string_view name) const {
+    bool exact = false;
+    int id = lowerBound(name, &exact);
+    return exact ? id : -1;
+}
+
+void FrontCodedDictionary::get(int id, string& out) const {
+    int block = id / BLOCK;
+    size_t pos = block_starts[block];
+    out.clear();
+    for (int i = block * BLOCK; i <= id; ++i) {
+        size_t shared = i % BLOCK == 0 ? 0 : getVarint(bytes, pos);
+        size_t rest = getVarint(bytes, pos);
+        out.resize(shared);
+        out.append(reinterpret_cast<const char*>(&bytes[pos]), rest);
+        pos += rest;
+    }
+}
+
+// strings with the prefix sit between the prefix itself and the next string that is bigger than every
+// one of them: the prefix with trailing 0xff bytes dropped and its last byte raised by one
+pair<int, int> FrontCodedDictionary::prefixRange(string_view prefix) const {
+    int first = lowerBound(prefix);
+
+    string bound(prefix);
+    while (!bound.empty() && static_cast<unsigned char>(bound.back()) == 0xff) bound.pop_back();
+    if (bound.empty()) return {first, count};
+
+    bound.back() = static_cast<char>(static_cast<unsigned char>(bound.back()) + 1);
+    return {first, lowerBound(bound)};
+}
+
+size_t FrontCodedDictionary::byteSize() const {
+    return bytes.capacity() + block_starts.capacity() * sizeof(size_t);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+
+// sorted, distinct strings packed in blocks of BLOCK: the first string of a block is stored whole, every other
+// one as the length it shares with the one before it plus the rest. lengths are varints. a string's id is its
+// position in sorted order, so everything starting with a prefix is one id range
+class FrontCodedDictionary {
+private:
+    static const int BLOCK = 16;
+
+    vector<unsigned char> bytes;
+    vector<size_t> block_starts;
+    int count = 0;
+
+    string_view blockHead(int block) const;
+    int lowerBound(string_view name, bool* exact = nullptr) const; // first id whose string isn't less than name
+
+public:
+    void build(const vector<string_view>& sorted); // sorted must be in ascending order without repeats
+
+    int size() const;
+    int find(string_view name) const; // -1 if absent
+    void get(int id, string& out) const; // decodes from the start of the id's block
+    pair<int, int> prefixRange(string_view prefix) const; // [first, last) of the strings starting with prefix
+    size_t byteSize() const;
+
+    // every string in id order, decoding each block once
+    template <class Visit>
+    void forEach(Visit visit) const;
+};
+
+template <class Visit>
+void FrontCodedDictionary::forEach(Visit visit) const {
+    string current;
+    size_t pos = 0;
+    auto varint = [this, &pos]() {
+        size_t value = 0;
+        for (int shift = 0;; shift += 7) {
+            unsigned char byte = bytes[pos++];
+            value |= static_cast<size_t>(byte & 0x7f) << shift;
+            if (byte < 0x80) return value;
+        }
+    };
+
+    for (int id = 0; id < count; ++id) {
+        size_t shared = id % BLOCK == 0 ? 0 : varint();
+        size_t rest = varint();
+        current.resize(shared);
+        current.append(reinterpret_cast<const char*>(&bytes[pos]), rest);
+        pos += rest;
+        visit(id, static_cast<const string&>(current));
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cstddef>
+#include <algorithm>
+
+using namespace std;
+
+// bytes held by each part of an AdjacencyList, heap sizes follow the libstdc++ / glibc layout.
+// pool resources skip the malloc header, so for them these are slight overestimates
+struct MemoryUsage {
+    size_t interner = 0; // page_to_id, the names themselves count under names
+    size_t names = 0; // id_to_page or the frozen names, and the names published with the ranks
+    size_t adjacency = 0; // csr, packed links and links not frozen yet
+    size_t ranks = 0; // the ranks map, ranks by id and the published snapshot
+    size_t bookkeeping = 0; // tombstones
+    size_t rank_run = 0; // temporaries of one calculatePageRank: old_ranks, out degrees, extrapolation history
+    size_t sorted_output = 0; // the map getSortedRanks builds
+
+    size_t resident() const { return interner + names + adjacency + ranks + bookkeeping; }
+    size_t peak() const { return resident() + max(rank_run, sorted_output); }
+};
+
+// what malloc really hands out for a request: 8 byte header, 16 byte steps, 32 bytes at least
+inline size_t heapBytes(size_t requested) {
+    if (requested == 0) return 0;
+    return max<size_t>((requested + 8 + 15) & ~static_cast<size_t>(15), 32);
+}
+
+// red black tree node: color and three pointers, then the value
+template <class K, class V>
+size_t mapNodeBytes() {
+    return heapBytes(32 + sizeof(pair<const K, V>));
+}
+
+// strings up to 15 characters live inside the string object
+template <class Alloc>
+size_t stringHeapBytes(const basic_string<char, char_traits<char>, Alloc>& s) {
+    return s.capacity() > 15 ? heapBytes(s.capacity() + 1) : 0;
+}
+
+template <class T>
+size_t vectorHeapBytes(const vector<T>& v) {
+    return heapBytes(v.capacity() * sizeof(T));
+}
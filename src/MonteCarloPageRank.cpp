@@ -0,0 +1,115 @@
+#include "MonteCarloPageRank.h"
+#include <random>
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
+MonteCarloPageRank::MonteCarloPageRank(AdjacencyList& graph, double damping)
+    : graph(graph), csr(graph.freeze()), damping_factor(damping) {
+    link_counts.resize(csr.nodes);
+    for (int j = 0; j < csr.nodes; ++j) {
+        link_counts[j] = csr.linkCount(j);
+    }
+
+    if (!csr.weights.empty()) {
+        weight_ends.resize(csr.weights.size());
+        for (int j = 0; j < csr.nodes; ++j) {
+            int running = 0;
+            for (int e = csr.offsets[j]; e < csr.offsets[j + 1]; ++e) {
+                running += csr.weights[e];
+                weight_ends[e] = running;
+            }
+        }
+    }
+}
+
+// visits a thread collects before adding them to the shared counts
+static const size_t PENDING_VISITS = 4096;
+
+// each walk keeps going with probability damping, follows a random out link and jumps to a random page from
+// a dangling page, so the visit counts end up proportional to damped PageRank
+void MonteCarloPageRank::walkRange(int first, int last, int walks_per_node, unsigned long long seed, vector<atomic<long long>>& visits) const {
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> coin(0.0, 1.0);
+    uniform_int_distribution<int> any_page(0, csr.nodes - 1);
+
+    // visits are buffered and sorted, so a popular page costs one atomic add per flush instead of one per visit
+    vector<int> pending;
+    pending.reserve(PENDING_VISITS);
+    auto flush = [&pending, &visits]() {
+        sort(pending.begin(), pending.end());
+        for (size_t i = 0; i < pending.size();) {
+            size_t run = i;
+            while (run < pending.size() && pending[run] == pending[i]) run++;
+            visits[pending[i]].fetch_add(static_cast<long long>(run - i), memory_order_relaxed);
+            i = run;
+        }
+        pending.clear();
+    };
+    auto visit = [&pending, &flush](int page) {
+        pending.push_back(page);
+        if (pending.size() == PENDING_VISITS) flush();
+    };
+
+    for (int start = first; start < last; ++start) {
+        for (int w = 0; w < walks_per_node; ++w) {
+            int current = start;
+            visit(current);
+
+            while (coin(rng) < damping_factor) {
+                int out_degree = link_counts[current];
+                if (out_degree == 0) {
+                    current = any_page(rng);
+                } else {
+                    uniform_int_distribution<int> pick(0, out_degree - 1);
+                    current = followLink(current, pick(rng));
+                }
+                visit(current);
+            }
+        }
+    }
+    flush();
+}
+
+// the nth of u's links counting duplicates, with weights it's the first link whose running weight passes n
+int MonteCarloPageRank::followLink(int u, int n) const {
+    int e = csr.offsets[u];
+    if (weight_ends.empty()) return csr.targets[e + n];
+
+    auto end = upper_bound(weight_ends.begin() + e, weight_ends.begin() + csr.offsets[u + 1], n);
+    return csr.targets[end - weight_ends.begin()];
+}
+
+// pages are split into one contiguous range per thread, all threads count into one shared array. counts are
+// whole numbers, so the order the threads add them in doesn't change the result
+map<string, double> MonteCarloPageRank::calculate(int walks_per_node, int threads, unsigned long long seed) const {
+    map<string, double> results;
+    int nodes = csr.nodes;
+    if (nodes == 0 || walks_per_node <= 0) return results;
+
+    if (threads <= 0) {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    threads = min(threads, nodes);
+
+    vector<atomic<long long>> visits(nodes);
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        int first = static_cast<int>(static_cast<long long>(nodes) * t / threads);
+        int last = static_cast<int>(static_cast<long long>(nodes) * (t + 1) / threads);
+        workers.emplace_back(&MonteCarloPageRank::walkRange, this, first, last, walks_per_node,
+                             seed * 1000003ULL + t, ref(visits));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // every visit is worth (1 - damping) / (n * walks) of rank
+    double scale = (1.0 - damping_factor) / (static_cast<double>(nodes) * walks_per_node);
+    for (int j = 0; j < nodes; ++j) {
+        results[graph.getPage(j)] = visits[j].load(memory_order_relaxed) * scale;
+    }
+
+    return results;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <atomic>
+#include "AdjacencyList.h"
+#include "CSRGraph.h"
+
+using namespace std;
+
+// approximate damped PageRank from short random walks, more walks per page means smaller error
+class MonteCarloPageRank {
+private:
+    const AdjacencyList& graph;
+    CSRGraph csr;
+    double damping_factor;
+    vector<int> link_counts; // out links of every page, repeated links counted
+    vector<int> weight_ends; // weights of a page's links summed up to and including each one, empty without weights
+
+    int followLink(int u, int n) const; // target of u's nth link, repeated links counted
+
+    // walks from pages [first, last), adds every page visit to the shared visits counts
+    void walkRange(int first, int last, int walks_per_node, unsigned long long seed, vector<atomic<long long>>& visits) const;
+
+public:
+    MonteCarloPageRank(AdjacencyList& graph, double damping = 0.85); // freezes the graph once
+
+    // threads = 0 uses every core, same seed and thread count give the same ranks
+    map<string, double> calculate(int walks_per_node, int threads = 0, unsigned long long seed = 1) const;
+};
@@ -0,0 +1,75 @@
+#include "NumaTopology.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+vector<NumaNode> discoverNumaNodes(const string& sysfs_root) {
+    vector<NumaNode> nodes;
+
+    error_code error;
+    for (filesystem::directory_iterator it(sysfs_root, error), end; !error && it != end; it.increment(error)) {
+        string name = it->path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+
+        ifstream in(it->path() / "cpulist");
+        string list;
+        if (!getline(in, list)) continue;
+
+        NumaNode node;
+        node.id = atoi(name.c_str() + 4);
+        node.cpus = parseCpuList(list);
+        if (!node.cpus.empty()) nodes.push_back(node);
+    }
+
+    if (nodes.size() <= 1) return {NumaNode()};
+
+    sort(nodes.begin(), nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    return nodes;
+}
+
+// malformed entries are skipped, sysfs doesn't write them but a bad file shouldn't stop a run
+vector<int> parseCpuList(const string& list) {
+    vector<int> cpus;
+    stringstream in(list);
+    string range;
+    while (getline(in, range, ',')) {
+        int first = 0, last = 0;
+        char extra = 0;
+        int fields = sscanf(range.c_str(), "%d-%d%c", &first, &last, &extra);
+        if (fields == 1) last = first;
+        if (fields < 1 || fields > 2 || first < 0 || last < first) continue;
+
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+bool pinThreadToCpus(const vector<int>& cpus) {
+#ifdef __linux__
+    if (cpus.empty()) return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
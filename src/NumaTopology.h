@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+struct NumaNode {
+    int id = 0;
+    vector<int> cpus; // empty when unknown, threads for this node are then left unpinned
+};
+
+// one entry per node directory under sysfs_root. without sysfs (or with a single node) this is one node with
+// no cpu list, so callers fall back to plain unpinned threads
+vector<NumaNode> discoverNumaNodes(const string& sysfs_root = "/sys/devices/system/node");
+
+// parses a sysfs cpu list such as "0-3,8-11"
+vector<int> parseCpuList(const string& list);
+
+// pins the calling thread to cpus, false if that isn't possible here
+bool pinThreadToCpus(const vector<int>& cpus);
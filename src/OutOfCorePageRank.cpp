@@ -0,0 +1,308 @@
+#include "OutOfCorePageRank.h"
+#include <iostream>
+#include <cstdio>
+#include <algorithm>
+#include <queue>
+#include <tuple>
+
+using namespace std;
+
+// links read or written per disk access
+static const size_t BUFFER_LINKS = 1 << 16;
+
+// names are stored as their length followed by the bytes
+static void writeName(ostream& out, const string& name) {
+    unsigned int length = static_cast<unsigned int>(name.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(name.data(), length);
+}
+
+static bool readName(istream& in, string& name) {
+    unsigned int length = 0;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length))) return false;
+    name.resize(length);
+    return static_cast<bool>(in.read(&name[0], length));
+}
+
+OutOfCorePageRank::OutOfCorePageRank(const string& path_prefix, int shards, size_t sort_memory)
+    : path_prefix(path_prefix), shard_count(max(shards, 1)), sort_memory(sort_memory) {
+    staged.open(path_prefix + ".links", ios::binary | ios::trunc);
+    if (!staged) {
+        cerr << "could not create " << path_prefix << ".links" << endl;
+    }
+}
+
+OutOfCorePageRank::~OutOfCorePageRank() {
+    staged.close();
+    remove((path_prefix + ".links").c_str());
+    remove((path_prefix + ".names").c_str());
+    for (int s = 0; s < shard_count; ++s) {
+        remove(partPath("shard", s).c_str());
+    }
+}
+
+void OutOfCorePageRank::addEdge(const string& from_page, const string& to_page) {
+    writeName(staged, from_page);
+    staged.put(to_page.empty() ? 0 : 1);
+    if (!to_page.empty()) {
+        writeName(staged, to_page);
+    }
+    records++;
+    built = false;
+}
+
+void OutOfCorePageRank::setDampingFactor(double damping) {
+    damping_factor = damping;
+}
+
+string OutOfCorePageRank::partPath(const string& kind, int n) const {
+    return path_prefix + "." + kind + to_string(n);
+}
+
+int OutOfCorePageRank::shardOf(int to_id) const {
+    return static_cast<int>(static_cast<long long>(to_id) * shard_count / nodes);
+}
+
+// 1. the staged names go into runs of at most sort_memory bytes, each sorted and written to its own file
+// 2. merging the runs gives every distinct name in order, so a name's id is its rank in that order. each
+//    position's id goes to the bucket file for its range of positions
+// 3. a bucket of ids fits in sort_memory, read back in order it gives the numbered links for the shards
+bool OutOfCorePageRank::build() {
+    staged.flush();
+    if (!staged) {
+        cerr << "could not write " << path_prefix << ".links" << endl;
+        return false;
+    }
+
+    // even, so both names of a link land in the same bucket
+    long long bucket_size = max<long long>(2, static_cast<long long>(sort_memory / sizeof(int)) / 2 * 2);
+    int runs = 0;
+    int buckets = 0;
+    built = writeRuns(runs) && mergeRuns(runs, bucket_size, buckets) && writeShards(bucket_size, buckets);
+    return built;
+}
+
+bool OutOfCorePageRank::writeRuns(int& runs) {
+    ifstream in(path_prefix + ".links", ios::binary);
+    vector<pair<string, long long>> run;
+    size_t run_bytes = 0;
+    bool ok = true;
+
+    auto spill = [&]() {
+        sort(run.begin(), run.end());
+        ofstream out(partPath("run", runs), ios::binary | ios::trunc);
+        for (const auto& name_position : run) {
+            writeName(out, name_position.first);
+            out.write(reinterpret_cast<const char*>(&name_position.second), sizeof(name_position.second));
+        }
+        out.flush();
+        if (!out) {
+            cerr << "could not write " << partPath("run", runs) << endl;
+            ok = false;
+        }
+        runs++;
+        run.clear();
+        run_bytes = 0;
+    };
+    auto add = [&](string& name, long long position) {
+        run_bytes += name.size() + sizeof(run[0]);
+        run.emplace_back(move(name), position);
+        if (run_bytes >= sort_memory) spill();
+    };
+
+    string from, to;
+    for (long long r = 0; r < records && ok; ++r) {
+        char has_link = 0;
+        if (!readName(in, from) || !in.get(has_link) || (has_link && !readName(in, to))) {
+            cerr << "could not read " << path_prefix << ".links" << endl;
+            return false;
+        }
+        add(from, 2 * r);
+        if (has_link) add(to, 2 * r + 1);
+    }
+    if (!run.empty()) spill();
+    return ok;
+}
+
+bool OutOfCorePageRank::mergeRuns(int runs, long long bucket_size, int& buckets) {
+    // (name, position, run) of the smallest unmerged entry of every run
+    using Head = tuple<string, long long, int>;
+    priority_queue<Head, vector<Head>, greater<Head>> heads;
+    vector<ifstream> inputs(runs);
+    auto next = [&](int run) {
+        string name;
+        long long position = 0;
+        if (readName(inputs[run], name) && inputs[run].read(reinterpret_cast<char*>(&position), sizeof(position))) {
+            heads.emplace(move(name), position, run);
+        }
+    };
+    for (int run = 0; run < runs; ++run) {
+        inputs[run].open(partPath("run", run), ios::binary);
+        next(run);
+    }
+
+    buckets = static_cast<int>((2 * records + bucket_size - 1) / bucket_size);
+    vector<ofstream> ids(buckets);
+    for (int b = 0; b < buckets; ++b) {
+        ids[b].open(partPath("ids", b), ios::binary | ios::trunc);
+    }
+
+    ofstream names(path_prefix + ".names", ios::binary | ios::trunc);
+    string last;
+    nodes = 0;
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+        const string& name = get<0>(head);
+        if (nodes == 0 || name != last) {
+            writeName(names, name);
+            last = name;
+            nodes++;
+        }
+
+        // (slot in the bucket, id)
+        long long position = get<1>(head);
+        pair<int, int> slot_id(static_cast<int>(position % bucket_size), nodes - 1);
+        ids[position / bucket_size].write(reinterpret_cast<const char*>(&slot_id), sizeof(slot_id));
+        next(get<2>(head));
+    }
+
+    bool ok = true;
+    for (int run = 0; run < runs; ++run) {
+        if (!inputs[run].eof()) {
+            cerr << "could not read " << partPath("run", run) << endl;
+            ok = false;
+        }
+        inputs[run].close();
+        remove(partPath("run", run).c_str());
+    }
+    for (int b = 0; b < buckets; ++b) {
+        ids[b].flush();
+        if (!ids[b]) {
+            cerr << "could not write " << partPath("ids", b) << endl;
+            ok = false;
+        }
+    }
+    names.flush();
+    if (!names) {
+        cerr << "could not write " << path_prefix << ".names" << endl;
+        ok = false;
+    }
+    return ok;
+}
+
+// one pass over the buckets, each link goes to the shard owning its destination range
+bool OutOfCorePageRank::writeShards(long long bucket_size, int buckets) {
+    vector<ofstream> shards(shard_count);
+    vector<vector<pair<int, int>>> pending(shard_count);
+    for (int s = 0; s < shard_count; ++s) {
+        shards[s].open(partPath("shard", s), ios::binary | ios::trunc);
+    }
+
+    auto write = [&](int s) {
+        shards[s].write(reinterpret_cast<const char*>(pending[s].data()), pending[s].size() * sizeof(pending[s][0]));
+        pending[s].clear();
+    };
+
+    out_degrees.assign(nodes, 0);
+    vector<int> ids(bucket_size);
+    vector<pair<int, int>> block(BUFFER_LINKS);
+    for (int b = 0; b < buckets; ++b) {
+        fill(ids.begin(), ids.end(), -1); // a to slot left at -1 is a page added without a link
+        ifstream in(partPath("ids", b), ios::binary);
+        while (in) {
+            in.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(block[0]));
+            size_t entries = static_cast<size_t>(in.gcount()) / sizeof(block[0]);
+            for (size_t i = 0; i < entries; ++i) {
+                ids[block[i].first] = block[i].second;
+            }
+        }
+        in.close();
+        remove(partPath("ids", b).c_str());
+
+        long long first = b * bucket_size;
+        long long last = min(first + bucket_size, 2 * records);
+        for (long long position = first; position < last; position += 2) {
+            int from = ids[position - first];
+            int to = ids[position - first + 1];
+            if (to == -1) continue;
+
+            out_degrees[from]++;
+            int s = shardOf(to);
+            pending[s].push_back({from, to});
+            if (pending[s].size() >= BUFFER_LINKS / shard_count + 1) {
+                write(s);
+            }
+        }
+    }
+
+    bool ok = true;
+    for (int s = 0; s < shard_count; ++s) {
+        write(s);
+        shards[s].flush();
+        if (!shards[s]) {
+            cerr << "could not write " << partPath("shard", s) << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// every iteration reads each shard once from start to end. a shard only adds to its own destination range,
+// so with shards processed in order the new ranks are written range after range
+bool OutOfCorePageRank::forEachRank(int power_iterations, const function<void(const string&, double)>& visit) {
+    if (records == 0 || power_iterations <= 0) return false;
+    if (!built && !build()) return false;
+
+    vector<double> old_ranks(nodes, 1.0 / nodes);
+    vector<double> ranks(nodes, 0.0);
+    vector<pair<int, int>> block(BUFFER_LINKS);
+
+    for (int p = 1; p < power_iterations; ++p) {
+        fill(ranks.begin(), ranks.end(), 0.0);
+
+        double dangling_mass = 0.0;
+        for (int j = 0; j < nodes; ++j) {
+            if (out_degrees[j] == 0) dangling_mass += old_ranks[j];
+        }
+
+        for (int s = 0; s < shard_count; ++s) {
+            ifstream in(partPath("shard", s), ios::binary);
+            while (in) {
+                in.read(reinterpret_cast<char*>(block.data()), block.size() * sizeof(block[0]));
+                size_t links = static_cast<size_t>(in.gcount()) / sizeof(block[0]);
+                for (size_t i = 0; i < links; ++i) {
+                    int from = block[i].first;
+                    ranks[block[i].second] += old_ranks[from] / out_degrees[from];
+                }
+            }
+        }
+
+        if (damping_factor > 0.0) {
+            double base = (1.0 - damping_factor) / nodes + damping_factor * dangling_mass / nodes;
+            for (int j = 0; j < nodes; ++j) {
+                ranks[j] = base + damping_factor * ranks[j];
+            }
+        }
+        old_ranks.swap(ranks);
+    }
+
+    ifstream names(path_prefix + ".names", ios::binary);
+    string name;
+    for (int j = 0; j < nodes; ++j) {
+        if (!readName(names, name)) {
+            cerr << "could not read " << path_prefix << ".names" << endl;
+            return false;
+        }
+        visit(name, old_ranks[j]);
+    }
+    return true;
+}
+
+map<string, double> OutOfCorePageRank::calculatePageRank(int power_iterations) {
+    map<string, double> results;
+    forEachRank(power_iterations, [&results](const string& page, double rank) {
+        results.emplace_hint(results.end(), page, rank);
+    });
+    return results;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+#include <functional>
+
+using namespace std;
+
+// PageRank for graphs whose links and page names don't fit in memory. addEdge only appends the names to disk,
+// build() numbers the pages with an external sort of the names (sorted runs of at most sort_memory bytes merged
+// into one names file), splits the numbered links into shards by destination range, and every iteration
+// streams the shards one after another. only out degrees and two rank arrays stay in memory
+class OutOfCorePageRank {
+private:
+    string path_prefix; // every file is path_prefix + ".links" / ".names" / ".shard<n>", ".run<n>" / ".ids<n>" during build
+    int shard_count;
+    size_t sort_memory; // bytes of names or ids build() holds at once
+    double damping_factor = 0.0; // same meaning as AdjacencyList::setDampingFactor
+
+    ofstream staged; // every addEdge so far, names in input order
+    long long records = 0; // addEdge calls in staged, the from name of call r is name 2r and the to name 2r + 1
+    int nodes = 0; // pages as of the last build, numbered in name order
+    vector<int> out_degrees;
+    bool built = false;
+
+    string partPath(const string& kind, int n) const;
+    int shardOf(int to_id) const; // destination range the link belongs to
+    bool writeRuns(int& runs); // sorted (name, position) runs of the staged names
+    bool mergeRuns(int runs, long long bucket_size, int& buckets); // names file plus the id of every position
+    bool writeShards(long long bucket_size, int buckets); // numbered links by destination, out degrees
+
+public:
+    OutOfCorePageRank(const string& path_prefix, int shards = 16, size_t sort_memory = 64 << 20);
+    ~OutOfCorePageRank(); // removes the files again
+
+    void addEdge(const string& from_url, const string& to_url);
+    void setDampingFactor(double damping);
+    bool build(); // numbers the pages and writes the shards, false if a file couldn't be read or written
+
+    // same iteration count and results as AdjacencyList::calculatePageRank, handed to visit in name order
+    // straight from the names file. false if there was nothing to rank or a file failed
+    bool forEachRank(int power_iterations, const function<void(const string&, double)>& visit);
+
+    // forEachRank collected into a map, which holds every name in memory again
+    map<string, double> calculatePageRank(int power_iterations);
+};
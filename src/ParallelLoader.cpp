@@ -0,0 +1,146 @@
+#include "ParallelLoader.h"
+#include <thread>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+ParallelLoader::ParallelLoader(int threads) : threads(threads) {
+    if (this->threads <= 0) {
+        this->threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+}
+
+// same rules as main.cpp, the first two words of a line and lines missing either one are skipped.
+// new pages are put in their shard's list here, so no later phase has to hash them again
+void ParallelLoader::parseChunk(const string& text, size_t begin, size_t end, Chunk& chunk) const {
+    unordered_map<string, int> local_ids;
+    hash<string> hasher;
+    chunk.shard_pages.assign(threads, vector<int>());
+    auto intern = [&](size_t start, size_t length) {
+        string page = text.substr(start, length);
+        auto it = local_ids.find(page);
+        if (it != local_ids.end()) return it->second;
+
+        int local_id = static_cast<int>(chunk.pages.size());
+        local_ids.emplace(page, local_id);
+        chunk.shard_pages[hasher(page) % threads].push_back(local_id);
+        chunk.pages.push_back(move(page));
+        chunk.first_seen.push_back(static_cast<long long>(start));
+        return local_id;
+    };
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; };
+
+    size_t pos = begin;
+    while (pos < end) {
+        size_t line_end = text.find('\n', pos);
+        if (line_end == string::npos || line_end > end) line_end = end;
+
+        size_t word_start[2], word_length[2];
+        int words = 0;
+        size_t i = pos;
+        while (words < 2) {
+            while (i < line_end && is_space(text[i])) i++;
+            if (i == line_end) break;
+            size_t start = i;
+            while (i < line_end && !is_space(text[i])) i++;
+            word_start[words] = start;
+            word_length[words] = i - start;
+            words++;
+        }
+
+        if (words == 2) {
+            int from = intern(word_start[0], word_length[0]);
+            int to = intern(word_start[1], word_length[1]);
+            chunk.edges.push_back({from, to});
+        }
+        pos = line_end + 1;
+    }
+}
+
+// 1. every thread parses one chunk of lines and interns into its own table
+// 2. every thread owns the pages hashing to its shard and keeps their earliest appearance
+// 3. sorting by earliest appearance gives the id's a line by line load would have given
+// 4. every thread rewrites its chunk's links to those id's
+void ParallelLoader::load(const string& text, AdjacencyList& graph) const {
+    if (text.empty()) return;
+
+    // chunk boundaries moved forward to the next line start
+    int chunk_count = threads;
+    vector<size_t> bounds(chunk_count + 1, text.size());
+    bounds[0] = 0;
+    for (int t = 1; t < chunk_count; ++t) {
+        size_t cut = max(bounds[t - 1], text.size() * t / chunk_count);
+        size_t newline = cut == 0 ? 0 : text.find('\n', cut - 1);
+        bounds[t] = newline == string::npos ? text.size() : newline + 1;
+    }
+
+    vector<Chunk> chunks(chunk_count);
+    vector<thread> workers;
+    for (int t = 0; t < chunk_count; ++t) {
+        workers.emplace_back(&ParallelLoader::parseChunk, this, cref(text), bounds[t], bounds[t + 1], ref(chunks[t]));
+    }
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+
+    // shard s holds every page whose hash lands on s, it only walks the pages the chunks put in its list.
+    // every chunk page gets a pointer to its entry, shards write different slots so they don't need a lock
+    int shard_count = threads;
+    for (Chunk& chunk : chunks) {
+        chunk.entries.assign(chunk.pages.size(), nullptr);
+    }
+    vector<unordered_map<string, ShardEntry>> shards(shard_count);
+    for (int s = 0; s < shard_count; ++s) {
+        workers.emplace_back([&, s]() {
+            for (Chunk& chunk : chunks) {
+                for (int i : chunk.shard_pages[s]) {
+                    auto inserted = shards[s].emplace(chunk.pages[i], ShardEntry{chunk.first_seen[i], -1});
+                    ShardEntry& entry = inserted.first->second;
+                    entry.first_seen = min(entry.first_seen, chunk.first_seen[i]);
+                    chunk.entries[i] = &entry;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+
+    // global order of first appearance, offsets are unique so there are no ties
+    vector<pair<long long, pair<const string, ShardEntry>*>> order;
+    for (auto& shard : shards) {
+        for (auto& page_entry : shard) {
+            order.push_back({page_entry.second.first_seen, &page_entry});
+        }
+    }
+    sort(order.begin(), order.end());
+
+    vector<string> pages;
+    pages.reserve(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        pages.push_back(order[i].second->first);
+        order[i].second->second.id = static_cast<int>(i);
+    }
+
+    vector<size_t> edge_start(chunk_count + 1, 0);
+    for (int t = 0; t < chunk_count; ++t) {
+        edge_start[t + 1] = edge_start[t] + chunks[t].edges.size();
+    }
+    vector<pair<int, int>> edges(edge_start[chunk_count]);
+
+    for (int t = 0; t < chunk_count; ++t) {
+        workers.emplace_back([&, t]() {
+            Chunk& chunk = chunks[t];
+            vector<int> global(chunk.pages.size());
+            for (size_t i = 0; i < chunk.pages.size(); ++i) {
+                global[i] = chunk.entries[i]->id;
+            }
+            for (size_t e = 0; e < chunk.edges.size(); ++e) {
+                edges[edge_start[t] + e] = {global[chunk.edges[e].first], global[chunk.edges[e].second]};
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    graph.addEdges(pages, edges);
+}
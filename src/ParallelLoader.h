@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include "AdjacencyList.h"
+
+using namespace std;
+
+// parses "from to" lines on several threads and bulk adds them to a graph. pages get the same id's
+// (and edges the same order) as calling addEdge line by line, so ranks come out identical
+class ParallelLoader {
+private:
+    int threads;
+
+    // a page in the shard that owns it
+    struct ShardEntry {
+        long long first_seen; // smallest offset any chunk saw it at
+        int id;               // global id, set once every shard is filled
+    };
+
+    // pages and links found in one chunk, id's are local to the chunk
+    struct Chunk {
+        vector<string> pages;
+        vector<long long> first_seen; // byte offset of each page's first appearance in the input
+        vector<pair<int, int>> edges;
+        vector<vector<int>> shard_pages; // local id's of the pages hashing to each shard, one shard per thread
+        vector<ShardEntry*> entries;     // each page's entry in its shard, filled in by the shard threads
+    };
+
+    void parseChunk(const string& text, size_t begin, size_t end, Chunk& chunk) const;
+
+public:
+    ParallelLoader(int threads = 0); // 0 uses every core
+
+    void load(const string& text, AdjacencyList& graph) const;
+};
@@ -0,0 +1,324 @@
+#include "ParallelPageRank.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+// range boundaries fall on multiples of this many pages, so no 4 KB page of a rank array is shared by two
+// ranges and each one gets first touched by its owner
+static const int PAGES_PER_MEMORY_PAGE = 4096 / sizeof(double);
+
+// links per task in deterministic mode, fixed so split pages are cut at the same places on any machine
+static const int DETERMINISTIC_TASK_LINKS = 4096;
+
+// pairwise sum whose order depends on count alone, and with less rounding error than a running sum
+static double treeSum(const double* values, size_t count) {
+    if (count <= 8) {
+        double sum = 0.0;
+        for (size_t i = 0; i < count; ++i) sum += values[i];
+        return sum;
+    }
+    size_t half = count / 2;
+    return treeSum(values, half) + treeSum(values + half, count - half);
+}
+
+// reusable barrier, waiting returns once every thread of the group has arrived
+class Barrier {
+private:
+    mutex lock;
+    condition_variable arrived;
+    int count;
+    int waiting = 0;
+    long long generation = 0;
+
+public:
+    explicit Barrier(int count) : count(count) {}
+
+    void wait() {
+        unique_lock<mutex> guard(lock);
+        long long current = generation;
+        if (++waiting == count) {
+            waiting = 0;
+            generation++;
+            arrived.notify_all();
+        } else {
+            arrived.wait(guard, [&]() { return generation != current; });
+        }
+    }
+};
+
+// tasks of one partition still to run, owners take them from the front and thieves from the back.
+// both ends sit in one word (front low, back high) so a single compare and swap claims a task
+struct alignas(64) TaskQueue {
+    atomic<unsigned long long> ends{0};
+
+    void reset(int count) {
+        ends.store(static_cast<unsigned long long>(count) << 32, memory_order_relaxed);
+    }
+
+    int take(bool from_back) {
+        unsigned long long current = ends.load(memory_order_relaxed);
+        while (true) {
+            unsigned long long front = current & 0xffffffffULL;
+            unsigned long long back = current >> 32;
+            if (front >= back) return -1;
+
+            unsigned long long wanted = from_back ? front | (back - 1) << 32 : (front + 1) | back << 32;
+            if (ends.compare_exchange_weak(current, wanted, memory_order_acq_rel, memory_order_relaxed)) {
+                return static_cast<int>(from_back ? back - 1 : front);
+            }
+        }
+    }
+};
+
+ParallelPageRank::ParallelPageRank(AdjacencyList& graph, int threads, double damping)
+    : graph(graph), threads(threads), damping_factor(damping) {
+    if (this->threads <= 0) {
+        this->threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    numa_nodes = discoverNumaNodes();
+
+    CSRGraph in_links;
+    CSRGraph csr = graph.freeze(&in_links);
+    nodes = csr.nodes;
+
+    // contiguous ranges, consecutive threads share a node
+    int count = this->threads;
+    partitions.resize(count);
+    for (int t = 0; t < count; ++t) {
+        auto boundary = [&](int k) {
+            long long pages = static_cast<long long>(nodes) * k / count;
+            return k == count ? nodes : static_cast<int>(min<long long>(nodes, pages / PAGES_PER_MEMORY_PAGE * PAGES_PER_MEMORY_PAGE));
+        };
+        partitions[t].begin = boundary(t);
+        partitions[t].end = boundary(t + 1);
+        partitions[t].numa_node = static_cast<int>(static_cast<long long>(t) * numa_nodes.size() / count);
+    }
+
+    runOnPartitions([&](int t) {
+        Partition& part = partitions[t];
+        int first = in_links.offsets[part.begin];
+        int last = in_links.offsets[part.end];
+
+        part.offsets.resize(part.end - part.begin + 1);
+        for (int v = part.begin; v <= part.end; ++v) {
+            part.offsets[v - part.begin] = in_links.offsets[v] - first;
+        }
+        part.sources.assign(in_links.targets.begin() + first, in_links.targets.begin() + last);
+        if (!in_links.weights.empty()) {
+            part.weights.assign(in_links.weights.begin() + first, in_links.weights.begin() + last);
+        }
+        part.link_counts.resize(part.end - part.begin);
+        for (int u = part.begin; u < part.end; ++u) {
+            part.link_counts[u - part.begin] = csr.linkCount(u);
+        }
+    });
+}
+
+// pages are added to a task until its links (plus one per page, so empty pages aren't free) reach task_links.
+// a page with more links than that gets tasks of its own, one per task_links links. the default size
+// follows the thread count, which moves where split pages are cut, deterministic mode uses a fixed one
+void ParallelPageRank::buildTasks() {
+    long long links = 0;
+    for (const Partition& part : partitions) {
+        links += part.sources.size();
+    }
+    int size = task_links > 0 ? task_links : static_cast<int>(max<long long>(256, links / (16 * partitions.size())));
+    if (deterministic && task_links == 0) size = DETERMINISTIC_TASK_LINKS;
+
+    slots = 0;
+    for (Partition& part : partitions) {
+        part.tasks.clear();
+        part.hubs.clear();
+
+        Task task;
+        task.begin = part.begin;
+        long long cost = 0;
+        for (int v = part.begin; v < part.end; ++v) {
+            int first = part.offsets[v - part.begin];
+            int last = part.offsets[v - part.begin + 1];
+
+            if (last - first > size) {
+                if (v > task.begin) {
+                    task.end = v;
+                    part.tasks.push_back(task);
+                }
+
+                Hub hub;
+                hub.page = v;
+                hub.first_slot = slots;
+                for (int e = first; e < last; e += size) {
+                    Task piece;
+                    piece.begin = v;
+                    piece.end = v + 1;
+                    piece.link_begin = e;
+                    piece.link_end = min(last, e + size);
+                    piece.slot = slots++;
+                    part.tasks.push_back(piece);
+                    hub.pieces++;
+                }
+                part.hubs.push_back(hub);
+
+                task = Task();
+                task.begin = v + 1;
+                cost = 0;
+                continue;
+            }
+
+            cost += last - first + 1;
+            if (cost >= size) {
+                task.end = v + 1;
+                part.tasks.push_back(task);
+                task = Task();
+                task.begin = v + 1;
+                cost = 0;
+            }
+        }
+        if (part.end > task.begin) {
+            task.end = part.end;
+            part.tasks.push_back(task);
+        }
+    }
+}
+
+void ParallelPageRank::setTaskSize(int links) {
+    task_links = max(links, 0);
+}
+
+void ParallelPageRank::setDeterministic(bool fixed) {
+    deterministic = fixed;
+}
+
+void ParallelPageRank::runOnPartitions(const function<void(int)>& work) {
+    bool pin = numa_nodes.size() > 1;
+    vector<thread> workers;
+    for (int t = 0; t < static_cast<int>(partitions.size()); ++t) {
+        workers.emplace_back([&, t]() {
+            if (pin) pinThreadToCpus(numa_nodes[partitions[t].numa_node].cpus);
+            work(t);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+}
+
+// every iteration has two phases split by barriers: each thread turns its pages' rank into the share sent
+// down each link (and sums the rank of its dangling pages), then the threads pull the new rank of every page
+// from those shares task by task, owners first. split pages are finished by their owner after the second barrier
+map<string, double> ParallelPageRank::calculate(int power_iterations) {
+    map<string, double> results;
+    if (nodes == 0 || power_iterations <= 0) return results;
+
+    buildTasks();
+    int count = static_cast<int>(partitions.size());
+
+    // left uninitialized here, every owner writes its own range of all three before the first barrier. thieves
+    // write stolen pages later, by then the memory pages are already placed on the owner's node
+    unique_ptr<double[]> rank(new double[nodes]);
+    unique_ptr<double[]> next(new double[nodes]);
+    unique_ptr<double[]> share(new double[nodes]);
+    vector<double> partial_sums(slots, 0.0);
+    // dangling rank per block of PAGES_PER_MEMORY_PAGE pages. ranges start on block boundaries, so every
+    // block has one owner and the blocks don't change with the thread count
+    int blocks = (nodes + PAGES_PER_MEMORY_PAGE - 1) / PAGES_PER_MEMORY_PAGE;
+    vector<double> dangling(blocks, 0.0);
+    vector<TaskQueue> queues(count);
+    Barrier barrier(count);
+
+    // who to steal from: the other partitions on the same node first, then the rest, both in a rotating order
+    vector<vector<int>> victims(count);
+    for (int t = 0; t < count; ++t) {
+        for (int same_node = 1; same_node >= 0; --same_node) {
+            for (int k = 1; k < count; ++k) {
+                int other = (t + k) % count;
+                if ((partitions[other].numa_node == partitions[t].numa_node) == (same_node == 1)) {
+                    victims[t].push_back(other);
+                }
+            }
+        }
+    }
+
+    runOnPartitions([&](int t) {
+        const Partition& part = partitions[t];
+        double* current = rank.get();
+        double* upcoming = next.get();
+
+        for (int j = part.begin; j < part.end; ++j) {
+            current[j] = 1.0 / nodes;
+            upcoming[j] = 0.0;
+            share[j] = 0.0;
+        }
+
+        for (int p = 1; p < power_iterations; ++p) {
+            for (int block_begin = part.begin; block_begin < part.end; block_begin += PAGES_PER_MEMORY_PAGE) {
+                double lost = 0.0;
+                for (int j = block_begin; j < min(part.end, block_begin + PAGES_PER_MEMORY_PAGE); ++j) {
+                    int links = part.link_counts[j - part.begin];
+                    if (links > 0) {
+                        share[j] = current[j] / links;
+                    } else {
+                        share[j] = 0.0;
+                        lost += current[j];
+                    }
+                }
+                dangling[block_begin / PAGES_PER_MEMORY_PAGE] = lost;
+            }
+            queues[t].reset(static_cast<int>(part.tasks.size()));
+            barrier.wait();
+
+            // every thread adds the block sums up the same way
+            double dangling_mass = treeSum(dangling.data(), dangling.size());
+            double base = (1.0 - damping_factor) / nodes + damping_factor * dangling_mass / nodes;
+
+            auto pull = [&](const Partition& owner, int first, int last) {
+                double sum = 0.0;
+                for (int e = first; e < last; ++e) {
+                    int weight = owner.weights.empty() ? 1 : owner.weights[e];
+                    sum += weight * share[owner.sources[e]];
+                }
+                return sum;
+            };
+            auto run = [&](const Partition& owner, const Task& task) {
+                if (task.slot != -1) {
+                    partial_sums[task.slot] = pull(owner, task.link_begin, task.link_end);
+                    return;
+                }
+                for (int v = task.begin; v < task.end; ++v) {
+                    double sum = pull(owner, owner.offsets[v - owner.begin], owner.offsets[v - owner.begin + 1]);
+                    upcoming[v] = damping_factor > 0.0 ? base + damping_factor * sum : sum;
+                }
+            };
+
+            for (int task = queues[t].take(false); task != -1; task = queues[t].take(false)) {
+                run(part, part.tasks[task]);
+            }
+            for (int other : victims[t]) {
+                for (int task = queues[other].take(true); task != -1; task = queues[other].take(true)) {
+                    run(partitions[other], partitions[other].tasks[task]);
+                }
+            }
+
+            // nobody may overwrite shares or dangling sums while someone still reads them
+            barrier.wait();
+
+            for (const Hub& hub : part.hubs) {
+                double sum = treeSum(&partial_sums[hub.first_slot], hub.pieces);
+                upcoming[hub.page] = damping_factor > 0.0 ? base + damping_factor * sum : sum;
+            }
+            swap(current, upcoming);
+        }
+    });
+
+    const double* final_rank = (power_iterations - 1) % 2 == 0 ? rank.get() : next.get();
+    for (int j = 0; j < nodes; ++j) {
+        results[graph.getPage(j)] = final_rank[j];
+    }
+    return results;
+}
+
+int ParallelPageRank::getNumaNodeCount() const {
+    return static_cast<int>(numa_nodes.size());
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include "AdjacencyList.h"
+#include "NumaTopology.h"
+
+using namespace std;
+
+// the same power iteration as AdjacencyList::calculatePageRank on several threads. every thread owns a range
+// of pages and pulls their rank over incoming links, so it only writes its own memory. ranges (incoming links,
+// out link counts and the rank slices) are built and first touched by their owner, pinned to one NUMA node.
+// each range is cut into tasks of about the same number of links, pages with more incoming links than that
+// are split over several tasks, and a thread that runs out of tasks steals from the others
+class ParallelPageRank {
+private:
+    const AdjacencyList& graph;
+    int threads;
+    double damping_factor;
+    int nodes = 0;
+    vector<NumaNode> numa_nodes;
+
+    // either pages [begin, end), or links [link_begin, link_end) of the single page begin when slot isn't -1.
+    // link indexes are relative to the partition
+    struct Task {
+        int begin = 0;
+        int end = 0;
+        int link_begin = 0;
+        int link_end = 0;
+        int slot = -1; // where a piece of a split page leaves its partial sum
+    };
+
+    // a split page, its pieces' partial sums are added up in slot order once every task is done
+    struct Hub {
+        int page = 0;
+        int first_slot = 0;
+        int pieces = 0;
+    };
+
+    // pages [begin, end) and what ranking them reads, offsets index sources relative to begin
+    struct Partition {
+        int begin = 0;
+        int end = 0;
+        int numa_node = 0;
+        vector<int> offsets;
+        vector<int> sources;
+        vector<int> weights; // empty means 1 each
+        vector<int> link_counts; // out links of every page in the range, repeated links counted
+        vector<Task> tasks;
+        vector<Hub> hubs;
+    };
+    vector<Partition> partitions;
+    int task_links = 0; // links per task, 0 picks about 16 tasks per thread
+    bool deterministic = false; // task size independent of the thread count
+    int slots = 0; // partial sums of split pages over all partitions
+
+    void buildTasks(); // cuts every partition into tasks for the current task_links
+
+    // one thread per partition, pinned to the partition's node when there is more than one node
+    void runOnPartitions(const function<void(int)>& work);
+
+public:
+    // freezes the graph, 0 threads uses every core, damping 0 is the undamped iteration like AdjacencyList
+    ParallelPageRank(AdjacencyList& graph, int threads = 0, double damping = 0.0);
+
+    map<string, double> calculate(int power_iterations); // same iteration count convention as calculatePageRank
+    void setTaskSize(int links); // incoming links per task, 0 sizes them from the graph
+
+    // fixed task sizes, so every sum is split and added up in an order that only depends on the graph and ranks come out
+    // bit for bit the same for any number of threads. costs nothing but the load balance of a tuned task size
+    void setDeterministic(bool fixed);
+
+    int getNumaNodeCount() const;
+};
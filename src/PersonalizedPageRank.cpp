@@ -0,0 +1,172 @@
+#include "PersonalizedPageRank.h"
+#include <set>
+#include <algorithm>
+#include <unordered_map>
+#include <deque>
+
+using namespace std;
+
+PersonalizedPageRank::PersonalizedPageRank(AdjacencyList& graph, double damping)
+    : graph(graph), csr(graph.freeze()), damping_factor(damping) {
+    link_counts.resize(csr.nodes);
+    for (int j = 0; j < csr.nodes; ++j) {
+        link_counts[j] = csr.linkCount(j);
+    }
+}
+
+// ranks are stored page by page with the K seed sets side by side (padded to a multiple of LANES),
+// so every edge is read once per iteration and updates all K values with one contiguous loop
+map<string, vector<double>> PersonalizedPageRank::calculateBatch(const vector<vector<string>>& seed_sets, int power_iterations) const {
+    map<string, vector<double>> results;
+    int nodes = csr.nodes;
+    int k_sets = static_cast<int>(seed_sets.size());
+    if (nodes == 0 || k_sets == 0) return results;
+
+    int stride = (k_sets + LANES - 1) / LANES * LANES;
+
+    // seed pages of every set, unknown pages are ignored
+    vector<vector<int>> seeds(k_sets);
+    for (int k = 0; k < k_sets; ++k) {
+        set<int> unique_seeds;
+        for (const auto& page : seed_sets[k]) {
+            int page_id = graph.getID(page);
+            if (page_id != -1) {
+                unique_seeds.insert(page_id);
+            }
+        }
+        seeds[k].assign(unique_seeds.begin(), unique_seeds.end());
+    }
+
+    // start every set from its own seed distribution
+    vector<double> old_ranks(static_cast<size_t>(nodes) * stride, 0.0);
+    vector<double> ranks(old_ranks.size(), 0.0);
+    for (int k = 0; k < k_sets; ++k) {
+        for (int s : seeds[k]) {
+            old_ranks[static_cast<size_t>(s) * stride + k] = 1.0 / seeds[k].size();
+        }
+    }
+
+    vector<double> share(stride);
+    vector<double> dangling_mass(stride);
+
+    for (int p = 1; p < power_iterations; ++p) {
+        fill(ranks.begin(), ranks.end(), 0.0);
+        fill(dangling_mass.begin(), dangling_mass.end(), 0.0);
+
+        for (int j = 0; j < nodes; ++j) {
+            const double* from = &old_ranks[static_cast<size_t>(j) * stride];
+            int out_degree = link_counts[j];
+
+            if (out_degree == 0) {
+                for (int b = 0; b < stride; b += LANES) {
+                    for (int l = 0; l < LANES; ++l) {
+                        dangling_mass[b + l] += from[b + l];
+                    }
+                }
+                continue;
+            }
+
+            double inverse_degree = 1.0 / out_degree;
+            for (int b = 0; b < stride; b += LANES) {
+                for (int l = 0; l < LANES; ++l) {
+                    share[b + l] = from[b + l] * inverse_degree;
+                }
+            }
+
+            for (int e = csr.offsets[j]; e < csr.offsets[j + 1]; ++e) {
+                double* to = &ranks[static_cast<size_t>(csr.targets[e]) * stride];
+                double weight = csr.weight(e);
+                for (int b = 0; b < stride; b += LANES) {
+                    for (int l = 0; l < LANES; ++l) {
+                        to[b + l] += weight * share[b + l];
+                    }
+                }
+            }
+        }
+
+        for (auto& value : ranks) {
+            value *= damping_factor;
+        }
+
+        // teleport and dangling rank of each set go back to its seeds
+        for (int k = 0; k < k_sets; ++k) {
+            if (seeds[k].empty()) continue;
+            double teleport = ((1.0 - damping_factor) + damping_factor * dangling_mass[k]) / seeds[k].size();
+            for (int s : seeds[k]) {
+                ranks[static_cast<size_t>(s) * stride + k] += teleport;
+            }
+        }
+
+        old_ranks.swap(ranks);
+    }
+
+    for (int j = 0; j < nodes; ++j) {
+        const double* values = &old_ranks[static_cast<size_t>(j) * stride];
+        results[graph.getPage(j)] = vector<double>(values, values + k_sets);
+    }
+
+    return results;
+}
+
+// residual rank waits in residual until a page has enough of it to be worth pushing, then a
+// (1 - damping) share settles on the page and the rest moves along its out links.
+// only pages that receive residual ever get an entry, so the cost depends on epsilon, not the graph size
+map<string, double> PersonalizedPageRank::calculateForwardPush(const string& seed, double epsilon) const {
+    map<string, double> results;
+    int seed_id = graph.getID(seed);
+    if (seed_id == -1 || seed_id >= csr.nodes) return results;
+
+    unordered_map<int, double> estimate;
+    unordered_map<int, double> residual;
+    deque<int> queue;
+    unordered_map<int, bool> queued;
+
+    // dangling pages count as degree 1 and send their rank back to the seed, like calculateBatch
+    auto threshold = [this, epsilon](int page_id) {
+        return epsilon * max(link_counts[page_id], 1);
+    };
+
+    residual[seed_id] = 1.0;
+    queue.push_back(seed_id);
+    queued[seed_id] = true;
+
+    while (!queue.empty()) {
+        int u = queue.front();
+        queue.pop_front();
+        queued[u] = false;
+
+        double mass = residual[u];
+        if (mass < threshold(u)) continue;
+
+        residual[u] = 0.0;
+        estimate[u] += (1.0 - damping_factor) * mass;
+
+        int out_degree = link_counts[u];
+        double pushed = damping_factor * mass;
+        if (out_degree == 0) {
+            residual[seed_id] += pushed;
+            if (!queued[seed_id] && residual[seed_id] >= threshold(seed_id)) {
+                queue.push_back(seed_id);
+                queued[seed_id] = true;
+            }
+            continue;
+        }
+
+        double share = pushed / out_degree;
+        for (int e = csr.offsets[u]; e < csr.offsets[u + 1]; ++e) {
+            int v = csr.targets[e];
+            double& r = residual[v];
+            r += csr.weight(e) * share;
+            if (!queued[v] && r >= threshold(v)) {
+                queue.push_back(v);
+                queued[v] = true;
+            }
+        }
+    }
+
+    for (const auto& page_estimate : estimate) {
+        results[graph.getPage(page_estimate.first)] = page_estimate.second;
+    }
+
+    return results;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include "AdjacencyList.h"
+#include "CSRGraph.h"
+
+using namespace std;
+
+// personalized PageRank, teleports (and dangling rank) go back to a seed set instead of every page
+class PersonalizedPageRank {
+private:
+    // rank values are processed in blocks of this many seed sets so the inner loops vectorize
+    static const int LANES = 4;
+
+    const AdjacencyList& graph;
+    CSRGraph csr;
+    double damping_factor;
+    vector<int> link_counts; // out links of every page, repeated links counted
+
+public:
+    PersonalizedPageRank(AdjacencyList& graph, double damping = 0.85); // freezes the graph once for every query
+
+    // one power iteration run for all seed sets together, K = seed_sets.size() values per page,
+    // power_iterations counts the same way as calculatePageRank
+    map<string, vector<double>> calculateBatch(const vector<vector<string>>& seed_sets, int power_iterations) const;
+
+    // approximate ranks for one seed page by local forward push (Andersen, Chung, Lang), only pages near the
+    // seed are touched, pushing stops once every residual is below epsilon times the page's out degree
+    map<string, double> calculateForwardPush(const string& seed, double epsilon) const;
+};
@@ -0,0 +1,236 @@
+#include "RankServer.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+// requests bigger than this close the connection instead of growing the buffer forever
+static const size_t MAX_PAYLOAD = 64 << 20;
+
+template <class T>
+static void append(string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// reads a T at offset, false if the payload is too short
+template <class T>
+static bool take(const char* payload, size_t length, size_t& offset, T& value) {
+    if (length - offset < sizeof(value)) return false;
+    memcpy(&value, payload + offset, sizeof(value));
+    offset += sizeof(value);
+    return true;
+}
+
+RankServer::RankServer(AdjacencyList& graph, const string& socket_path) : graph(graph), socket_path(socket_path) {}
+
+RankServer::~RankServer() {
+    if (recompute_thread.joinable()) recompute_thread.join();
+    for (Connection& connection : connections) {
+        close(connection.fd);
+    }
+    if (listen_fd != -1) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+}
+
+bool RankServer::start() {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        cerr << "socket path too long " << socket_path << endl;
+        return false;
+    }
+    memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1) {
+        cerr << "could not create socket: " << strerror(errno) << endl;
+        return false;
+    }
+
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 64) != 0) {
+        cerr << "could not listen on " << socket_path << ": " << strerror(errno) << endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+// one poll loop for every connection: read whatever arrived, answer all complete requests, write what fits
+void RankServer::run() {
+    if (listen_fd == -1) return;
+
+    vector<char> buffer(1 << 16);
+    while (true) {
+        bool pending_output = false;
+        vector<pollfd> watched;
+        if (!stopping) watched.push_back({listen_fd, POLLIN, 0});
+        for (const Connection& connection : connections) {
+            short events = (stopping ? 0 : POLLIN) | (connection.out.empty() ? 0 : POLLOUT);
+            pending_output = pending_output || !connection.out.empty();
+            watched.push_back({connection.fd, events, 0});
+        }
+        if (stopping && !pending_output) break;
+
+        if (poll(watched.data(), watched.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            cerr << "poll failed: " << strerror(errno) << endl;
+            break;
+        }
+
+        size_t first_connection = stopping ? 0 : 1;
+        vector<bool> keep(connections.size(), true);
+        for (size_t c = 0; c < connections.size(); ++c) {
+            Connection& connection = connections[c];
+            short events = watched[first_connection + c].revents;
+
+            if (events & POLLIN) {
+                ssize_t got = read(connection.fd, buffer.data(), buffer.size());
+                if (got > 0) {
+                    connection.in.append(buffer.data(), got);
+                    keep[c] = serveRequests(connection);
+                } else if (got == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    keep[c] = false;
+                }
+            } else if (events & (POLLHUP | POLLERR)) {
+                keep[c] = false;
+            }
+
+            if (keep[c] && !connection.out.empty()) {
+                keep[c] = flush(connection);
+            }
+        }
+
+        size_t kept = 0;
+        for (size_t c = 0; c < connections.size(); ++c) {
+            if (keep[c]) {
+                connections[kept++] = move(connections[c]);
+            } else {
+                close(connections[c].fd);
+            }
+        }
+        connections.resize(kept);
+
+        if (!stopping && (watched[0].revents & POLLIN)) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd != -1) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                Connection connection;
+                connection.fd = fd;
+                connections.push_back(move(connection));
+            }
+        }
+    }
+
+    if (recompute_thread.joinable()) recompute_thread.join();
+}
+
+bool RankServer::flush(Connection& connection) {
+    while (!connection.out.empty()) {
+        ssize_t sent = send(connection.fd, connection.out.data(), connection.out.size(), MSG_NOSIGNAL);
+        if (sent < 0) return errno == EAGAIN || errno == EINTR;
+        connection.out.erase(0, sent);
+    }
+    return true;
+}
+
+bool RankServer::serveRequests(Connection& connection) {
+    const size_t header = 1 + sizeof(unsigned int);
+    size_t used = 0;
+
+    while (connection.in.size() - used >= header) {
+        unsigned char op = static_cast<unsigned char>(connection.in[used]);
+        unsigned int length = 0;
+        memcpy(&length, connection.in.data() + used + 1, sizeof(length));
+        if (length > MAX_PAYLOAD) return false;
+        if (connection.in.size() - used - header < length) break;
+
+        const char* payload = connection.in.data() + used + header;
+        used += header + length;
+        size_t offset = 0;
+
+        // every query works on one snapshot, a recompute finishing halfway doesn't mix two runs
+        shared_ptr<const RankSnapshot> snapshot = graph.getRankSnapshot();
+        string body;
+
+        if (op == LOOKUP) {
+            unsigned int count = 0;
+            if (!take(payload, length, offset, count)) return false;
+
+            string url;
+            for (unsigned int i = 0; i < count; ++i) {
+                unsigned int url_length = 0;
+                if (!take(payload, length, offset, url_length) || length - offset < url_length) return false;
+                url.assign(payload + offset, url_length);
+                offset += url_length;
+                append(body, snapshot ? snapshot->getRank(url) : -1.0);
+            }
+        } else if (op == TOP) {
+            unsigned int k = 0;
+            if (!take(payload, length, offset, k)) return false;
+
+            if (snapshot && snapshot != top_snapshot) {
+                top_order.resize(snapshot->ranks.size());
+                for (size_t i = 0; i < top_order.size(); ++i) top_order[i] = static_cast<int>(i);
+                stable_sort(top_order.begin(), top_order.end(), [&snapshot](int a, int b) {
+                    return snapshot->ranks[a] > snapshot->ranks[b];
+                });
+                top_snapshot = snapshot;
+            }
+
+            unsigned int count = snapshot ? static_cast<unsigned int>(min<size_t>(k, top_order.size())) : 0;
+            append(body, count);
+            string page;
+            for (unsigned int i = 0; i < count; ++i) {
+                snapshot->pages->get(top_order[i], page);
+                append(body, static_cast<unsigned int>(page.size()));
+                body += page;
+                append(body, snapshot->ranks[top_order[i]]);
+            }
+        } else if (op == RECOMPUTE) {
+            int iterations = 0;
+            if (!take(payload, length, offset, iterations)) return false;
+
+            bool started = !recomputing;
+            if (started) startRecompute(iterations);
+            append(body, static_cast<unsigned char>(started));
+        } else if (op == VERSION) {
+            append(body, snapshot ? snapshot->version : 0LL);
+            append(body, static_cast<unsigned char>(recomputing.load()));
+        } else if (op == SHUTDOWN) {
+            stopping = true;
+        } else {
+            return false;
+        }
+
+        append(connection.out, static_cast<unsigned int>(body.size()));
+        connection.out += body;
+        if (stopping) break;
+    }
+
+    connection.in.erase(0, used);
+    return true;
+}
+
+// the run publishes a new snapshot when it is done, queries keep using the old one until then
+void RankServer::startRecompute(int iterations) {
+    if (recompute_thread.joinable()) recompute_thread.join();
+
+    recomputing = true;
+    recompute_thread = thread([this, iterations]() {
+        graph.calculatePageRank(iterations);
+        recomputing = false;
+    });
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include "AdjacencyList.h"
+#include "RankSnapshot.h"
+
+using namespace std;
+
+// keeps a graph loaded and answers rank queries over a unix domain socket until a SHUTDOWN request.
+// a request is a 1 byte op, a 4 byte payload length and the payload. answers are a 4 byte length and the
+// body, sent in request order, so a client can pipeline as many requests as it likes. numbers are in host
+// byte order since the socket never leaves the machine, strings are a 4 byte length and the bytes.
+//   LOOKUP    count, then count urls           -> count doubles, -1 for unknown pages
+//   TOP       k                                -> count, then count (url, double), highest rank first
+//   RECOMPUTE iterations                       -> 1 byte, 1 if a run started, 0 if one is still going
+//   VERSION   nothing                          -> 8 byte version of the ranks served, 1 byte run going
+//   SHUTDOWN  nothing                          -> an empty answer (length 0), the server stops once it is sent
+// queries read the published rank snapshot, so they keep being answered while a recompute runs
+class RankServer {
+public:
+    enum Op : unsigned char { LOOKUP = 1, TOP = 2, RECOMPUTE = 3, VERSION = 4, SHUTDOWN = 5 };
+
+private:
+    struct Connection {
+        int fd = -1;
+        string in; // bytes of requests not complete yet
+        string out; // answers not sent yet
+    };
+
+    AdjacencyList& graph;
+    string socket_path;
+    int listen_fd = -1;
+    vector<Connection> connections;
+    bool stopping = false;
+
+    thread recompute_thread;
+    atomic<bool> recomputing{false};
+
+    // pages of top_snapshot by rank, made the first time TOP asks about a snapshot
+    shared_ptr<const RankSnapshot> top_snapshot;
+    vector<int> top_order;
+
+    bool serveRequests(Connection& connection); // answers every complete request, false on a malformed one
+    bool flush(Connection& connection); // false once the client is gone
+    void startRecompute(int iterations);
+
+public:
+    RankServer(AdjacencyList& graph, const string& socket_path);
+    ~RankServer(); // closes everything and removes the socket file
+
+    bool start(); // binds the socket, false with a message on cerr if it can't
+    void run(); // serves until SHUTDOWN
+};
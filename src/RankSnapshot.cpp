@@ -0,0 +1,53 @@
+#include "RankSnapshot.h"
+#include <thread>
+
+using namespace std;
+
+double RankSnapshot::getRank(const string& page) const {
+    if (!pages) return -1.0;
+
+    int i = pages->find(page);
+    return i == -1 ? -1.0 : ranks[i];
+}
+
+map<string, double> RankSnapshot::toMap() const {
+    map<string, double> sorted_results;
+    if (!pages) return sorted_results;
+
+    pages->forEach([&](int i, const string& page) {
+        sorted_results.emplace_hint(sorted_results.end(), page, ranks[i]);
+    });
+    return sorted_results;
+}
+
+RankSnapshotSlot::RankSnapshotSlot(RankSnapshotSlot&& other) noexcept : current(other.current.exchange(nullptr)) {
+}
+
+RankSnapshotSlot::~RankSnapshotSlot() {
+    delete current.load();
+}
+
+// every step is sequentially consistent: a reader that counted itself before store looked at the readers is
+// waited for, one that counted itself after it can only see the new snapshot
+shared_ptr<const RankSnapshot> RankSnapshotSlot::load() const {
+    int side = static_cast<int>(epoch.load() & 1);
+    readers[side].fetch_add(1);
+
+    shared_ptr<const RankSnapshot> snapshot;
+    if (const shared_ptr<const RankSnapshot>* published = current.load()) {
+        snapshot = *published;
+    }
+
+    readers[side].fetch_sub(1);
+    return snapshot;
+}
+
+// new readers go to the other side once the epoch flips, so the old side drains even under constant reads
+void RankSnapshotSlot::store(shared_ptr<const RankSnapshot> snapshot) {
+    shared_ptr<const RankSnapshot>* old = current.exchange(new shared_ptr<const RankSnapshot>(move(snapshot)));
+    int side = static_cast<int>(epoch.fetch_add(1) & 1);
+    while (readers[side].load() != 0) {
+        this_thread::yield();
+    }
+    delete old;
+}
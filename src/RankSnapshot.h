@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <atomic>
+#include "FrontCodedDictionary.h"
+
+using namespace std;
+
+// ranks of one calculatePageRank run, never changed once published. pages are sorted by name and shared
+// with later snapshots until the set of pages changes
+struct RankSnapshot {
+    long long version = 0; // counts runs, starting at 1
+    shared_ptr<const FrontCodedDictionary> pages;
+    vector<double> ranks; // ranks[i] belongs to the page with id i in pages
+
+    double getRank(const string& page) const; // -1 if the page isn't in this snapshot
+    map<string, double> toMap() const; // same as getSortedRanks gave right after the run
+};
+
+// the published snapshot, handed out without locks. a reader counts itself in the current epoch's side while it
+// copies the shared_ptr, store swaps in a new one, flips the epoch and waits until the old side is empty before
+// dropping the old one. readers never wait, the writer waits at most for copies already in flight
+class RankSnapshotSlot {
+private:
+    atomic<shared_ptr<const RankSnapshot>*> current{nullptr};
+    atomic<long long> epoch{0};
+    mutable atomic<int> readers[2] = {{0}, {0}};
+
+public:
+    RankSnapshotSlot() = default;
+    RankSnapshotSlot(RankSnapshotSlot&& other) noexcept; // not while other is read from
+    RankSnapshotSlot& operator=(RankSnapshotSlot&&) = delete;
+    ~RankSnapshotSlot();
+
+    shared_ptr<const RankSnapshot> load() const; // null before the first store
+    void store(shared_ptr<const RankSnapshot> snapshot); // one writer at a time
+};
@@ -0,0 +1,156 @@
+#include "SCCPageRank.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+SCCPageRank::SCCPageRank(AdjacencyList& graph, double damping)
+    : graph(graph), damping_factor(damping) {
+    csr = graph.freeze(&in_links);
+
+    link_counts.resize(csr.nodes);
+    for (int j = 0; j < csr.nodes; ++j) {
+        link_counts[j] = csr.linkCount(j);
+    }
+
+    findComponents();
+}
+
+// tarjan with an explicit stack of (page, next link to look at). components come out sinks first,
+// so the numbering already has every link going from a higher to a lower (or the same) component
+void SCCPageRank::findComponents() {
+    int nodes = csr.nodes;
+    component.assign(nodes, -1);
+    component_count = 0;
+
+    vector<int> index(nodes, -1);
+    vector<int> lowlink(nodes, 0);
+    vector<bool> on_stack(nodes, false);
+    vector<int> scc_stack;
+    vector<pair<int, int>> call_stack;
+    int next_index = 0;
+
+    for (int root = 0; root < nodes; ++root) {
+        if (index[root] != -1) continue;
+
+        call_stack.push_back({root, csr.offsets[root]});
+        index[root] = lowlink[root] = next_index++;
+        scc_stack.push_back(root);
+        on_stack[root] = true;
+
+        while (!call_stack.empty()) {
+            int u = call_stack.back().first;
+            int& edge = call_stack.back().second;
+
+            if (edge < csr.offsets[u + 1]) {
+                int v = csr.targets[edge++];
+                if (index[v] == -1) {
+                    index[v] = lowlink[v] = next_index++;
+                    scc_stack.push_back(v);
+                    on_stack[v] = true;
+                    call_stack.push_back({v, csr.offsets[v]});
+                } else if (on_stack[v]) {
+                    lowlink[u] = min(lowlink[u], index[v]);
+                }
+                continue;
+            }
+
+            // all links of u done, u is the root of a component if nothing reached further back
+            if (lowlink[u] == index[u]) {
+                int member;
+                do {
+                    member = scc_stack.back();
+                    scc_stack.pop_back();
+                    on_stack[member] = false;
+                    component[member] = component_count;
+                } while (member != u);
+                component_count++;
+            }
+
+            call_stack.pop_back();
+            if (!call_stack.empty()) {
+                int parent = call_stack.back().first;
+                lowlink[parent] = min(lowlink[parent], lowlink[u]);
+            }
+        }
+    }
+}
+
+// solves x = (1 - d) / n + d * (sum of x[u] / out_degree(u) over links u -> v) with rank on dangling pages dropped,
+// then normalizes. spreading dangling rank evenly only scales that solution, so this equals damped calculatePageRank
+map<string, double> SCCPageRank::calculate(double tolerance, int max_sweeps) const {
+    map<string, double> results;
+    int nodes = csr.nodes;
+    if (nodes == 0) return results;
+
+    // pages grouped by component, highest number (sources) first
+    vector<int> order(nodes);
+    for (int j = 0; j < nodes; ++j) {
+        order[j] = j;
+    }
+    stable_sort(order.begin(), order.end(), [this](int a, int b) { return component[a] > component[b]; });
+
+    double base = (1.0 - damping_factor) / nodes;
+    vector<double> x(nodes, 0.0);
+
+    // rank flowing into v over all incoming links, finished components are already final
+    auto pull = [&](int v, double& self_weight) {
+        double incoming = 0.0;
+        self_weight = 0.0;
+        for (int e = in_links.offsets[v]; e < in_links.offsets[v + 1]; ++e) {
+            int u = in_links.targets[e];
+            if (u == v) {
+                self_weight += damping_factor * in_links.weight(e) / link_counts[u];
+            } else {
+                incoming += in_links.weight(e) * x[u] / link_counts[u];
+            }
+        }
+        return base + damping_factor * incoming;
+    };
+
+    for (int first = 0; first < nodes;) {
+        int last = first;
+        while (last < nodes && component[order[last]] == component[order[first]]) {
+            last++;
+        }
+
+        if (last - first == 1) {
+            // not on a cycle (except maybe with itself), one step settles it
+            int v = order[first];
+            double self_weight;
+            double value = pull(v, self_weight);
+            x[v] = value / (1.0 - self_weight);
+        } else {
+            // gauss seidel sweeps over just this component
+            for (int sweep = 0; sweep < max_sweeps; ++sweep) {
+                double change = 0.0;
+                double total = 0.0;
+                for (int i = first; i < last; ++i) {
+                    int v = order[i];
+                    double self_weight;
+                    double value = pull(v, self_weight) / (1.0 - self_weight);
+                    change += fabs(value - x[v]);
+                    total += value;
+                    x[v] = value;
+                }
+                if (change <= tolerance * total) break;
+            }
+        }
+
+        first = last;
+    }
+
+    double total = 0.0;
+    for (double value : x) {
+        total += value;
+    }
+    for (int j = 0; j < nodes; ++j) {
+        results[graph.getPage(j)] = x[j] / total;
+    }
+
+    return results;
+}
+
+int SCCPageRank::getComponentCount() const {
+    return component_count;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include "AdjacencyList.h"
+#include "CSRGraph.h"
+
+using namespace std;
+
+// damped PageRank solved one strongly connected component at a time in topological order,
+// pages outside of cycles are settled in one step and only real components are iterated
+class SCCPageRank {
+private:
+    const AdjacencyList& graph;
+    CSRGraph csr;
+    CSRGraph in_links; // transposed csr from the same freeze, the solver pulls rank over incoming links
+    vector<int> link_counts; // out links of every page, repeated links counted
+    double damping_factor;
+
+    // component of every page, numbered so that links only go from higher to lower numbers
+    vector<int> component;
+    int component_count = 0;
+
+    void findComponents(); // iterative tarjan, no recursion so long chains can't overflow the stack
+
+public:
+    SCCPageRank(AdjacencyList& graph, double damping = 0.85); // freezes the graph and finds the components
+
+    // tolerance is the L1 change (relative to the component's rank) at which a component counts as solved
+    map<string, double> calculate(double tolerance = 1e-12, int max_sweeps = 10000) const;
+
+    int getComponentCount() const;
+};
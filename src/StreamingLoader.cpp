@@ -0,0 +1,138 @@
+#include "StreamingLoader.h"
+#include <thread>
+#include <map>
+
+using namespace std;
+
+StreamingLoader::StreamingLoader(int parsers, size_t block_bytes, int queue_depth)
+    : parsers(max(parsers, 1)), block_bytes(max<size_t>(block_bytes, 1)), queue_depth(max(queue_depth, 1)) {}
+
+// a block ends after its last complete line, the partial line is carried into the next one.
+// stops after the requested number of lines, the last line may be missing its newline
+void StreamingLoader::readBlocks(istream& in, int lines, BoundedQueue<Block>& blocks) const {
+    vector<char> buffer(block_bytes);
+    string carry;
+    long long sequence = 0;
+    int remaining = lines;
+
+    while (remaining > 0) {
+        in.read(buffer.data(), buffer.size());
+        size_t got = static_cast<size_t>(in.gcount());
+        bool end_of_input = got < buffer.size();
+
+        Block block;
+        block.text.swap(carry);
+        block.text.append(buffer.data(), got);
+
+        size_t cut = 0;
+        while (remaining > 0) {
+            size_t newline = block.text.find('\n', cut);
+            if (newline == string::npos) break;
+            remaining--;
+            cut = newline + 1;
+        }
+        if (remaining > 0 && end_of_input && cut < block.text.size()) {
+            remaining--;
+            cut = block.text.size();
+        }
+
+        carry.assign(block.text, cut, string::npos);
+        block.text.resize(cut);
+        if (!block.text.empty()) {
+            block.sequence = sequence++;
+            blocks.push(move(block));
+        }
+        if (end_of_input) break;
+    }
+
+    blocks.close();
+}
+
+// the first two words of a line, lines missing either one are skipped
+void StreamingLoader::parseBlock(Block& block) {
+    const string& text = block.text;
+    auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f'; };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t line_end = text.find('\n', pos);
+        if (line_end == string::npos) line_end = text.size();
+
+        size_t word_start[2], word_length[2];
+        int words = 0;
+        size_t i = pos;
+        while (words < 2) {
+            while (i < line_end && is_space(text[i])) i++;
+            if (i == line_end) break;
+            size_t start = i;
+            while (i < line_end && !is_space(text[i])) i++;
+            word_start[words] = start;
+            word_length[words] = i - start;
+            words++;
+        }
+
+        if (words == 2) {
+            block.words.insert(block.words.end(), {word_start[0], word_length[0], word_start[1], word_length[1]});
+        }
+        pos = line_end + 1;
+    }
+}
+
+// parsed blocks can finish out of order, they wait in ready until the ones before them are added.
+// a parser only parks a block there while it is less than queue_depth ahead, which bounds ready too
+void StreamingLoader::load(istream& in, int lines, const function<void(const string&, const string&)>& add) const {
+    BoundedQueue<Block> blocks(queue_depth);
+    mutex ready_lock;
+    condition_variable ready_changed;
+    map<long long, Block> ready;
+    long long next = 0;
+    int running = parsers;
+
+    thread reader(&StreamingLoader::readBlocks, this, ref(in), lines, ref(blocks));
+
+    vector<thread> workers;
+    for (int t = 0; t < parsers; ++t) {
+        workers.emplace_back([&]() {
+            Block block;
+            while (blocks.pop(block)) {
+                parseBlock(block);
+
+                unique_lock<mutex> guard(ready_lock);
+                ready_changed.wait(guard, [&]() { return block.sequence < next + queue_depth; });
+                long long sequence = block.sequence;
+                ready.emplace(sequence, move(block));
+                ready_changed.notify_all();
+            }
+
+            lock_guard<mutex> guard(ready_lock);
+            running--;
+            ready_changed.notify_all();
+        });
+    }
+
+    // reused for every link so adding doesn't allocate
+    string from, to;
+    while (true) {
+        Block block;
+        {
+            unique_lock<mutex> guard(ready_lock);
+            ready_changed.wait(guard, [&]() { return ready.count(next) > 0 || running == 0; });
+            auto it = ready.find(next);
+            if (it == ready.end()) break;
+
+            block = move(it->second);
+            ready.erase(it);
+            next++;
+            ready_changed.notify_all();
+        }
+
+        for (size_t w = 0; w < block.words.size(); w += 4) {
+            from.assign(block.text, block.words[w], block.words[w + 1]);
+            to.assign(block.text, block.words[w + 2], block.words[w + 3]);
+            add(from, to);
+        }
+    }
+
+    reader.join();
+    for (auto& worker : workers) worker.join();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+using namespace std;
+
+// fixed capacity queue between pipeline stages, push waits while it is full and pop while it is empty.
+// pop fails once the queue is closed and drained
+template <class T>
+class BoundedQueue {
+private:
+    mutex lock;
+    condition_variable not_full, not_empty;
+    deque<T> items;
+    size_t capacity;
+    bool closed = false;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(max<size_t>(capacity, 1)) {}
+
+    void push(T item) {
+        unique_lock<mutex> guard(lock);
+        not_full.wait(guard, [this] { return items.size() < capacity; });
+        items.push_back(move(item));
+        not_empty.notify_one();
+    }
+
+    bool pop(T& item) {
+        unique_lock<mutex> guard(lock);
+        not_empty.wait(guard, [this] { return !items.empty() || closed; });
+        if (items.empty()) return false;
+
+        item = move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        not_empty.notify_all();
+    }
+};
+
+// reads "from to" lines in three overlapping stages: a reader thread cuts the stream into blocks of whole lines,
+// parser threads find the two words of every line, and the calling thread hands the pairs to add in input order,
+// so pages get the same id's as a line by line load. at most queue_depth blocks wait between two stages
+class StreamingLoader {
+private:
+    int parsers;
+    size_t block_bytes;
+    int queue_depth;
+
+    struct Block {
+        long long sequence = 0;
+        string text;
+        vector<size_t> words; // start and length of both words of every line that has two
+    };
+
+    void readBlocks(istream& in, int lines, BoundedQueue<Block>& blocks) const;
+    static void parseBlock(Block& block);
+
+public:
+    StreamingLoader(int parsers = 1, size_t block_bytes = 1 << 20, int queue_depth = 4);
+
+    // reads at most lines lines, same skipping rules as main.cpp
+    void load(istream& in, int lines, const function<void(const string&, const string&)>& add) const;
+};
@@ -0,0 +1,138 @@
+#include "StringSort.h"
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+using namespace std;
+
+// below this many ids one thread is faster than starting more
+static const size_t PARALLEL_MINIMUM = 1 << 14;
+
+// buckets per thread, so threads that draw small buckets pick up more
+static const int BUCKETS_PER_THREAD = 4;
+static const int SAMPLES_PER_BUCKET = 16;
+
+static void runParallel(int threads, const function<void(int)>& work) {
+    vector<thread> workers;
+    for (int t = 1; t < threads; ++t) {
+        workers.emplace_back(work, t);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// character depth of s, -1 past the end so shorter strings sort first
+static int charAt(string_view s, size_t depth) {
+    return depth < s.size() ? static_cast<unsigned char>(s[depth]) : -1;
+}
+
+// every id here shares its first depth characters with the others
+static void multikeyQuicksort(int* ids, size_t count, const vector<string_view>& names, size_t depth) {
+    while (count > 16) {
+        int a = charAt(names[ids[0]], depth);
+        int b = charAt(names[ids[count / 2]], depth);
+        int c = charAt(names[ids[count - 1]], depth);
+        int pivot = max(min(a, b), min(max(a, b), c));
+
+        // three way partition: [0, less) below the pivot character, [less, greater) equal, the rest above
+        size_t less = 0, i = 0, greater = count;
+        while (i < greater) {
+            int character = charAt(names[ids[i]], depth);
+            if (character < pivot) {
+                swap(ids[less++], ids[i++]);
+            } else if (character > pivot) {
+                swap(ids[i], ids[--greater]);
+            } else {
+                i++;
+            }
+        }
+
+        multikeyQuicksort(ids, less, names, depth);
+        multikeyQuicksort(ids + greater, count - greater, names, depth);
+
+        // strings that ended here are all equal, the rest go on with the next character
+        if (pivot == -1) return;
+        ids += less;
+        count = greater - less;
+        depth++;
+    }
+
+    for (size_t i = 1; i < count; ++i) {
+        int id = ids[i];
+        string_view rest = names[id].substr(min(depth, names[id].size()));
+        size_t j = i;
+        while (j > 0 && names[ids[j - 1]].substr(min(depth, names[ids[j - 1]].size())) > rest) {
+            ids[j] = ids[j - 1];
+            j--;
+        }
+        ids[j] = id;
+    }
+}
+
+// 1. evenly spaced samples are sorted and every SAMPLES_PER_BUCKET-th one becomes a splitter
+// 2. every thread finds the bucket of each id in its slice and counts them
+// 3. a prefix sum over (bucket, thread) gives every thread where to write, then it scatters its slice
+// 4. threads take whole buckets off a shared counter and sort them in place
+void sortByName(vector<int>& ids, const vector<string_view>& names, int threads) {
+    if (threads <= 0) {
+        threads = max(1, static_cast<int>(thread::hardware_concurrency()));
+    }
+    size_t count = ids.size();
+    if (threads == 1 || count < PARALLEL_MINIMUM) {
+        multikeyQuicksort(ids.data(), count, names, 0);
+        return;
+    }
+
+    int buckets = threads * BUCKETS_PER_THREAD;
+    vector<int> sample(static_cast<size_t>(buckets) * SAMPLES_PER_BUCKET);
+    for (size_t s = 0; s < sample.size(); ++s) {
+        sample[s] = ids[s * count / sample.size()];
+    }
+    multikeyQuicksort(sample.data(), sample.size(), names, 0);
+    vector<string_view> splitters;
+    for (int k = 1; k < buckets; ++k) {
+        splitters.push_back(names[sample[static_cast<size_t>(k) * SAMPLES_PER_BUCKET]]);
+    }
+
+    auto slice_begin = [count, threads](int t) { return count * t / threads; };
+    vector<int> bucket_of(count);
+    vector<size_t> counts(static_cast<size_t>(threads) * buckets, 0);
+    runParallel(threads, [&](int t) {
+        for (size_t i = slice_begin(t); i < slice_begin(t + 1); ++i) {
+            int bucket = static_cast<int>(upper_bound(splitters.begin(), splitters.end(), names[ids[i]]) - splitters.begin());
+            bucket_of[i] = bucket;
+            counts[static_cast<size_t>(t) * buckets + bucket]++;
+        }
+    });
+
+    vector<size_t> bucket_start(buckets + 1, 0);
+    vector<size_t> cursor(counts.size());
+    size_t position = 0;
+    for (int b = 0; b < buckets; ++b) {
+        bucket_start[b] = position;
+        for (int t = 0; t < threads; ++t) {
+            cursor[static_cast<size_t>(t) * buckets + b] = position;
+            position += counts[static_cast<size_t>(t) * buckets + b];
+        }
+    }
+    bucket_start[buckets] = position;
+
+    vector<int> dealt(count);
+    runParallel(threads, [&](int t) {
+        size_t* next = &cursor[static_cast<size_t>(t) * buckets];
+        for (size_t i = slice_begin(t); i < slice_begin(t + 1); ++i) {
+            dealt[next[bucket_of[i]]++] = ids[i];
+        }
+    });
+
+    atomic<int> next_bucket{0};
+    runParallel(threads, [&](int) {
+        for (int b = next_bucket++; b < buckets; b = next_bucket++) {
+            multikeyQuicksort(dealt.data() + bucket_start[b], bucket_start[b + 1] - bucket_start[b], names, 0);
+        }
+    });
+    ids.swap(dealt);
+}
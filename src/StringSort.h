@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+
+using namespace std;
+
+// sorts ids by names[id] in byte order (the order map<string, ...> uses) on several threads, 0 uses every core.
+// a sample sort first deals the ids into buckets between splitter names, then every bucket gets a multikey
+// quicksort, which compares each character of a shared prefix once instead of once per comparison
+void sortByName(vector<int>& ids, const vector<string_view>& names, int threads = 0);
@@ -2,20 +2,138 @@
 #include <vector>
 #include <string>
 #include <iomanip> // For fixed and setprecision
+#include <iterator>
+#include <memory>
 #include "AdjacencyList.h"
+#include "MonteCarloPageRank.h"
+#include "ParallelLoader.h"
+#include "OutOfCorePageRank.h"
+#include "StreamingLoader.h"
+#include "ParallelPageRank.h"
+#include "RankServer.h"
 
 using namespace std;
 
 // Using example shown in project 2 breakdown video as inspiration for paring input
-int main() {
+// optional arguments: --checkpoint <file> [--checkpoint-every <iterations>] to resume long runs
+//                     --damping <factor> for damped PageRank
+//                     --tolerance <l1 change> to stop early, --extrapolate <every> for quadratic extrapolation
+//                     --monte-carlo <walks per page> for quick approximate ranks instead of power iteration
+//                     --parallel-rank to run the power iteration on --threads threads (no tolerance, extrapolation or checkpoints)
+//                     --deterministic to make --parallel-rank give bit for bit the same ranks for any thread count
+//                     --threads <count> to parse the input and build the graph on several threads
+//                     --stream to read, parse and add links in overlapping stages instead of reading everything first
+//                     --collapse-duplicates to store repeated links once with a weight
+//                     --compress to keep the links delta encoded while ranking
+//                     --front-code-names to keep the page names sorted and prefix compressed once loaded
+//                     --out-of-core <file prefix> [--shards <count>] to keep the links and page names on disk instead of in memory
+//                     --memory-budget <megabytes> to pick representations that fit, prints the memory use to cerr
+//                     --serve <socket path> to rank once and then answer queries over a unix socket instead of printing
+int main(int argc, char* argv[]) {
+    string checkpoint_file;
+    int checkpoint_every = 10;
+    double damping = 0.0;
+    int monte_carlo_walks = 0;
+    double tolerance = 0.0;
+    int extrapolate_every = 0;
+    int threads = 1;
+    bool collapse_duplicates = false;
+    bool compress = false;
+    bool stream = false;
+    bool parallel_rank = false;
+    bool front_code_names = false;
+    bool deterministic = false;
+    string out_of_core_prefix;
+    int shards = 16;
+    double memory_budget_mb = 0.0;
+    string serve_socket;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_file = argv[++i];
+        } else if (arg == "--checkpoint-every" && i + 1 < argc) {
+            checkpoint_every = stoi(argv[++i]);
+        } else if (arg == "--damping" && i + 1 < argc) {
+            damping = stod(argv[++i]);
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = stod(argv[++i]);
+        } else if (arg == "--extrapolate" && i + 1 < argc) {
+            extrapolate_every = stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = stoi(argv[++i]);
+        } else if (arg == "--collapse-duplicates") {
+            collapse_duplicates = true;
+        } else if (arg == "--compress") {
+            compress = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--parallel-rank") {
+            parallel_rank = true;
+        } else if (arg == "--deterministic") {
+            deterministic = true;
+        } else if (arg == "--front-code-names") {
+            front_code_names = true;
+        } else if (arg == "--out-of-core" && i + 1 < argc) {
+            out_of_core_prefix = argv[++i];
+        } else if (arg == "--shards" && i + 1 < argc) {
+            shards = stoi(argv[++i]);
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve_socket = argv[++i];
+        } else if (arg == "--memory-budget" && i + 1 < argc) {
+            memory_budget_mb = stod(argv[++i]);
+        } else if (arg == "--monte-carlo" && i + 1 < argc) {
+            monte_carlo_walks = stoi(argv[++i]);
+        } else {
+            cerr << "unknown argument " << arg << endl;
+            return 1;
+        }
+    }
+
     int n = 0, p = 0; // n = lines, p = power iterations
     cin >> n >> p;
 
     AdjacencyList graph;
+    graph.setThreads(threads);
+    graph.setCollapseDuplicates(collapse_duplicates);
+    graph.setCompressedStorage(compress);
     string from_page, to_page;
 
+    // links go straight to disk instead of into graph
+    unique_ptr<OutOfCorePageRank> out_of_core;
+    if (!out_of_core_prefix.empty()) {
+        out_of_core.reset(new OutOfCorePageRank(out_of_core_prefix, shards));
+        out_of_core->setDampingFactor(damping);
+    }
+
+    // same n + 1 lines as the loop below (the first one is the rest of the header line), parsed in parallel
+    bool parallel_load = threads > 1 && !out_of_core && !stream;
+    if (parallel_load) {
+        string text((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+        size_t end = 0;
+        for (int i = 0; i < n + 1 && end < text.size(); i++) {
+            size_t newline = text.find('\n', end);
+            end = newline == string::npos ? text.size() : newline + 1;
+        }
+        text.resize(end);
+
+        ParallelLoader loader(threads);
+        loader.load(text, graph);
+    }
+
+    // same lines again, with reading overlapped with parsing and adding, memory stays bounded by the queues
+    if (stream) {
+        StreamingLoader loader(threads);
+        loader.load(cin, n + 1, [&](const string& from, const string& to) {
+            if (out_of_core) {
+                out_of_core->addEdge(from, to);
+            } else {
+                graph.addEdge(from, to);
+            }
+        });
+    }
+
     // Project 2 breakdown video example input
-    for ( int i = 0; i < n+1; i++)
+    for ( int i = 0; i < n+1 && !parallel_load && !stream; i++)
     {
         string line;
         getline(cin, line);
@@ -32,17 +150,68 @@ int main() {
             continue;
         }
 
-        graph.addEdge(from, to);
+        if (out_of_core) {
+            out_of_core->addEdge(from, to);
+        } else {
+            graph.addEdge(from, to);
+        }
     }
 
-    // calculating ranks and sorting pages alphabetically
-    graph.calculatePageRank(p);
-    map<string, double> final_ranks = graph.getSortedRanks();
+    if (front_code_names) {
+        graph.freezeNames();
+    }
+
+    // calculating ranks and sorting pages alphabetically, picking up a matching checkpoint if there is one
+    graph.setDampingFactor(damping);
+    graph.setTolerance(tolerance);
+    graph.setExtrapolation(extrapolate_every);
+    if (!checkpoint_file.empty()) {
+        graph.setCheckpoint(checkpoint_file, checkpoint_every);
+    }
+    if (memory_budget_mb > 0.0 && !out_of_core) {
+        if (!graph.fitMemoryBudget(static_cast<size_t>(memory_budget_mb * 1024 * 1024))) {
+            cerr << "graph does not fit in " << memory_budget_mb << " MB" << endl;
+        }
+        MemoryUsage usage = graph.getMemoryUsage();
+        cerr << "interner " << usage.interner << " names " << usage.names << " adjacency " << usage.adjacency
+             << " ranks " << usage.ranks << " rank run " << usage.rank_run << " output " << usage.sorted_output
+             << " peak " << usage.peak() << " bytes" << endl;
+    }
+
+    // stays up answering queries about this graph until a client asks it to shut down
+    if (!serve_socket.empty()) {
+        graph.calculatePageRank(p);
+        RankServer server(graph, serve_socket);
+        if (!server.start()) return 1;
+        server.run();
+        return 0;
+    }
 
     // using project 2 breakdown video example output
     cout << fixed << showpoint;
     cout << setprecision(2);
 
+    // names come back from disk in order, so they are printed as they are read instead of collected first
+    if (out_of_core) {
+        out_of_core->forEachRank(p, [](const string& page, double rank) {
+            cout << page << " " << rank << endl;
+        });
+        return 0;
+    }
+
+    map<string, double> final_ranks;
+    if (monte_carlo_walks > 0) {
+        MonteCarloPageRank estimator(graph, damping > 0.0 ? damping : 0.85);
+        final_ranks = estimator.calculate(monte_carlo_walks);
+    } else if (parallel_rank) {
+        ParallelPageRank ranker(graph, threads, damping);
+        ranker.setDeterministic(deterministic);
+        final_ranks = ranker.calculate(p);
+    } else {
+        graph.calculatePageRank(p);
+        final_ranks = graph.getSortedRanks();
+    }
+
     for (const auto& page_rank : final_ranks) {
         //cout << "page rank first: " << page_rank.first << " page rank second " << page_rank.second << endl;
         cout << page_rank.first << " " << page_rank.second << endl;
@@ -1,7 +1,34 @@
 //#include <catch2/catch_test_macros.hpp>
 #include "catch/catch_amalgamated.hpp"
 #include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
 #include "AdjacencyList.h"
+#include "PersonalizedPageRank.h"
+#include "MonteCarloPageRank.h"
+#include "SCCPageRank.h"
+#include "ParallelLoader.h"
+#include "CSRGraph.h"
+#include "CompressedAdjacency.h"
+#include "OutOfCorePageRank.h"
+#include "StreamingLoader.h"
+#include "ParallelPageRank.h"
+#include "NumaTopology.h"
+#include "RankServer.h"
+#include "FrontCodedDictionary.h"
+#include "StringSort.h"
+#include "ConcurrentIngest.h"
+#include <random>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <sstream>
 
 TEST_CASE("Test 1: Add a single directed edge") {
     AdjacencyList graph;
@@ -44,3 +71,1249 @@ TEST_CASE("Test 5: PageRank on disconnected node") {
 
     REQUIRE(result == "");
 }
+
+// the small graph most of the tests below start from, every page has out links
+static void addSampleGraph(AdjacencyList& graph) {
+    graph.addEdge("google.com", "gmail.com");
+    graph.addEdge("google.com", "maps.com");
+    graph.addEdge("facebook.com", "ufl.edu");
+    graph.addEdge("ufl.edu", "google.com");
+    graph.addEdge("ufl.edu", "gmail.com");
+    graph.addEdge("maps.com", "facebook.com");
+    graph.addEdge("gmail.com", "maps.com");
+}
+
+TEST_CASE("Test 6: Resuming from a checkpoint matches an uninterrupted run") {
+    const std::string checkpoint = "test_checkpoint.bin";
+    std::remove(checkpoint.c_str());
+
+    AdjacencyList uninterrupted;
+    AdjacencyList first_half;
+    AdjacencyList resumed;
+    for (AdjacencyList* graph : {&uninterrupted, &first_half, &resumed}) {
+        addSampleGraph(*graph);
+    }
+
+    uninterrupted.calculatePageRank(12);
+
+    // first run "dies" after 5 iterations, second one picks up the checkpoint it left behind
+    first_half.setCheckpoint(checkpoint, 2);
+    first_half.calculatePageRank(5);
+    resumed.setCheckpoint(checkpoint, 2);
+    resumed.calculatePageRank(12);
+
+    REQUIRE(resumed.getSortedRanks() == uninterrupted.getSortedRanks());
+
+    // a checkpoint from a different graph is ignored
+    AdjacencyList other;
+    other.addEdge("A", "B");
+    other.addEdge("B", "A");
+    other.setCheckpoint(checkpoint, 2);
+    other.calculatePageRank(3);
+    REQUIRE(other.getSortedRanks().at("A") == Catch::Approx(0.5));
+
+    std::remove(checkpoint.c_str());
+}
+
+TEST_CASE("Test 7: Removing pages and links matches a rebuilt graph") {
+    AdjacencyList graph;
+    addSampleGraph(graph);
+    graph.addEdge("dead.com", "google.com");
+    graph.addEdge("maps.com", "dead.com");
+    graph.calculatePageRank(2); // freezes, so the removals below tombstone frozen links
+
+    graph.removeNode("dead.com");
+    graph.removeEdge("ufl.edu", "gmail.com");
+    graph.calculatePageRank(8);
+
+    AdjacencyList rebuilt;
+    rebuilt.addEdge("google.com", "gmail.com");
+    rebuilt.addEdge("google.com", "maps.com");
+    rebuilt.addEdge("facebook.com", "ufl.edu");
+    rebuilt.addEdge("ufl.edu", "google.com");
+    rebuilt.addEdge("maps.com", "facebook.com");
+    rebuilt.addEdge("gmail.com", "maps.com");
+    rebuilt.calculatePageRank(8);
+
+    map<string, double> expected = rebuilt.getSortedRanks();
+    map<string, double> actual = graph.getSortedRanks();
+    REQUIRE(actual.size() == expected.size());
+    REQUIRE(actual.count("dead.com") == 0);
+    for (const auto& page_rank : expected) {
+        REQUIRE(actual.at(page_rank.first) == Catch::Approx(page_rank.second));
+    }
+
+    // a removed name can come back as a new page
+    graph.addEdge("dead.com", "google.com");
+    graph.calculatePageRank(2);
+    REQUIRE(graph.getSortedRanks().count("dead.com") == 1);
+}
+
+TEST_CASE("Test 8: Damped PageRank keeps rank of dangling pages") {
+    AdjacencyList graph;
+    graph.addEdge("A", "B");
+    graph.addEdge("A", "C");
+    graph.addEdge("B", "C");
+    graph.addEdge("C", "D"); // D has no out links
+
+    graph.setDampingFactor(0.85);
+    graph.calculatePageRank(100);
+    map<string, double> ranks = graph.getSortedRanks();
+
+    double total = 0.0;
+    for (const auto& page_rank : ranks) {
+        total += page_rank.second;
+    }
+    REQUIRE(total == Catch::Approx(1.0));
+
+    // converged ranks satisfy r = (1 - d) / n + d * (incoming + dangling / n)
+    double base = 0.15 / 4 + 0.85 * ranks["D"] / 4;
+    REQUIRE(ranks["A"] == Catch::Approx(base));
+    REQUIRE(ranks["B"] == Catch::Approx(base + 0.85 * ranks["A"] / 2));
+    REQUIRE(ranks["C"] == Catch::Approx(base + 0.85 * (ranks["A"] / 2 + ranks["B"])));
+    REQUIRE(ranks["D"] == Catch::Approx(base + 0.85 * ranks["C"]));
+}
+
+TEST_CASE("Test 9: Batched personalized PageRank") {
+    AdjacencyList graph;
+    addSampleGraph(graph);
+    graph.addEdge("maps.com", "github.com"); // dangling
+
+    PersonalizedPageRank ppr(graph, 0.85);
+    vector<string> everything = {"google.com", "gmail.com", "maps.com", "facebook.com", "ufl.edu", "github.com"};
+    vector<vector<string>> seed_sets = {{"google.com"}, everything, {"ufl.edu", "maps.com"}, {"github.com"}, {"unknown.com"}};
+    map<string, vector<double>> batch = ppr.calculateBatch(seed_sets, 30);
+
+    // seeding every page is plain damped PageRank
+    graph.setDampingFactor(0.85);
+    graph.calculatePageRank(30);
+    for (const auto& page_rank : graph.getSortedRanks()) {
+        REQUIRE(batch.at(page_rank.first)[1] == Catch::Approx(page_rank.second));
+    }
+
+    // each lane is independent of the others in the batch
+    for (size_t k = 0; k < seed_sets.size(); ++k) {
+        map<string, vector<double>> single = ppr.calculateBatch({seed_sets[k]}, 30);
+        for (const auto& page_ranks : single) {
+            REQUIRE(batch.at(page_ranks.first)[k] == page_ranks.second[0]);
+        }
+    }
+
+    REQUIRE(batch.at("google.com")[0] > batch.at("facebook.com")[0]);
+    REQUIRE(batch.at("google.com")[4] == 0.0);
+}
+
+TEST_CASE("Test 10: Forward push approximates single seed personalized PageRank") {
+    AdjacencyList graph;
+    addSampleGraph(graph);
+    graph.addEdge("maps.com", "github.com");
+    graph.addEdge("island.com", "reef.com"); // not reachable from the seed
+
+    PersonalizedPageRank ppr(graph, 0.85);
+    map<string, vector<double>> exact = ppr.calculateBatch({{"gmail.com"}}, 200);
+    map<string, double> pushed = ppr.calculateForwardPush("gmail.com", 1e-9);
+
+    REQUIRE(pushed.count("island.com") == 0);
+    REQUIRE(pushed.count("reef.com") == 0);
+    for (const auto& page_rank : pushed) {
+        REQUIRE(page_rank.second == Catch::Approx(exact.at(page_rank.first)[0]).margin(1e-6));
+    }
+    REQUIRE(ppr.calculateForwardPush("unknown.com", 1e-4).empty());
+}
+
+TEST_CASE("Test 11: Monte Carlo estimate approaches damped PageRank") {
+    AdjacencyList graph;
+    addSampleGraph(graph);
+    graph.addEdge("maps.com", "github.com");
+
+    graph.setDampingFactor(0.85);
+    graph.calculatePageRank(100);
+    map<string, double> exact = graph.getSortedRanks();
+
+    MonteCarloPageRank estimator(graph, 0.85);
+    map<string, double> rough = estimator.calculate(20, 2);
+    map<string, double> fine = estimator.calculate(20000, 2);
+
+    double rough_error = 0.0, fine_error = 0.0;
+    for (const auto& page_rank : exact) {
+        rough_error += std::abs(rough.at(page_rank.first) - page_rank.second);
+        fine_error += std::abs(fine.at(page_rank.first) - page_rank.second);
+    }
+    REQUIRE(fine_error < 0.02);
+    REQUIRE(fine_error < rough_error);
+
+    // same seed and thread count, same answer
+    REQUIRE(estimator.calculate(20, 2) == rough);
+}
+
+TEST_CASE("Test 12: Quadratic extrapolation converges in fewer iterations") {
+    // two clusters joined by a single link converge slowly at high damping
+    AdjacencyList plain, accelerated, first_half, resumed;
+    for (AdjacencyList* graph : {&plain, &accelerated, &first_half, &resumed}) {
+        for (int cluster = 0; cluster < 2; ++cluster) {
+            for (int i = 0; i < 50; ++i) {
+                string prefix = std::to_string(cluster) + "-";
+                graph->addEdge(prefix + std::to_string(i), prefix + std::to_string((i * 7 + 1) % 50));
+                graph->addEdge(prefix + std::to_string(i), prefix + std::to_string((i * 11 + 3) % 50));
+            }
+        }
+        graph->addEdge("0-0", "1-1");
+        graph->setDampingFactor(0.99);
+        graph->setTolerance(1e-10);
+    }
+
+    plain.calculatePageRank(10000);
+    accelerated.setExtrapolation(20);
+    accelerated.calculatePageRank(10000);
+
+    REQUIRE(accelerated.getIterationsRun() < plain.getIterationsRun());
+    map<string, double> expected = plain.getSortedRanks();
+    for (const auto& page_rank : accelerated.getSortedRanks()) {
+        REQUIRE(page_rank.second == Catch::Approx(expected.at(page_rank.first)).epsilon(1e-6));
+    }
+
+    // checkpoints still resume to the exact same answer with extrapolation on
+    const std::string checkpoint = "test_checkpoint_extrapolation.bin";
+    std::remove(checkpoint.c_str());
+    first_half.setExtrapolation(20);
+    first_half.setCheckpoint(checkpoint, 7);
+    first_half.calculatePageRank(60);
+    resumed.setExtrapolation(20);
+    resumed.setCheckpoint(checkpoint, 7);
+    resumed.calculatePageRank(10000);
+    REQUIRE(resumed.getSortedRanks() == accelerated.getSortedRanks());
+
+    // a checkpoint from a run without a tolerance is ignored, it may be past where this run stops
+    AdjacencyList untolerant, tolerant;
+    for (AdjacencyList* graph : {&untolerant, &tolerant}) {
+        addSampleGraph(*graph);
+        graph->setDampingFactor(0.85);
+        graph->setCheckpoint(checkpoint, 10);
+    }
+    std::remove(checkpoint.c_str());
+    untolerant.calculatePageRank(200);
+    tolerant.setTolerance(1e-6);
+    tolerant.calculatePageRank(10000);
+    AdjacencyList fresh;
+    addSampleGraph(fresh);
+    fresh.setDampingFactor(0.85);
+    fresh.setTolerance(1e-6);
+    fresh.calculatePageRank(10000);
+    REQUIRE(tolerant.getIterationsRun() == fresh.getIterationsRun());
+    REQUIRE(tolerant.getSortedRanks() == fresh.getSortedRanks());
+    std::remove(checkpoint.c_str());
+}
+
+TEST_CASE("Test 13: Component by component solver matches damped PageRank") {
+    AdjacencyList graph;
+    addSampleGraph(graph);
+    graph.addEdge("maps.com", "github.com"); // dangling fringe
+    graph.addEdge("blog.com", "ufl.edu"); // acyclic fringe into the core
+    graph.addEdge("blog.com", "blog.com");
+    graph.addEdge("feed.com", "blog.com");
+
+    graph.setDampingFactor(0.85);
+    graph.setTolerance(1e-14);
+    graph.calculatePageRank(10000);
+
+    SCCPageRank solver(graph, 0.85);
+    REQUIRE(solver.getComponentCount() == 4);
+    map<string, double> ranks = solver.calculate();
+    for (const auto& page_rank : graph.getSortedRanks()) {
+        REQUIRE(ranks.at(page_rank.first) == Catch::Approx(page_rank.second).epsilon(1e-9));
+    }
+}
+
+TEST_CASE("Test 14: Component search handles very long chains") {
+    AdjacencyList chain;
+    for (int i = 0; i < 200000; ++i) {
+        chain.addEdge("page" + std::to_string(i), "page" + std::to_string(i + 1));
+    }
+
+    SCCPageRank solver(chain, 0.85);
+    REQUIRE(solver.getComponentCount() == 200001);
+
+    map<string, double> ranks = solver.calculate();
+    double total = 0.0;
+    for (const auto& page_rank : ranks) {
+        total += page_rank.second;
+    }
+    REQUIRE(total == Catch::Approx(1.0));
+    REQUIRE(ranks.at("page1") > ranks.at("page0"));
+}
+
+TEST_CASE("Test 15: Parallel loading gives the same graph as addEdge") {
+    std::string text;
+    AdjacencyList serial;
+    for (int i = 0; i < 3000; ++i) {
+        std::string from = "site" + std::to_string(i * 7 % 1000) + ".com";
+        std::string to = "site" + std::to_string(i * 13 % 1200) + ".com";
+        text += from + " " + to + "\n";
+        serial.addEdge(from, to);
+        if (i % 500 == 0) {
+            text += "lonely" + std::to_string(i) + ".com\n"; // no target, skipped like main.cpp does
+        }
+    }
+
+    AdjacencyList parallel;
+    ParallelLoader loader(4);
+    loader.load(text, parallel);
+
+    REQUIRE(parallel.getNodeCount() == serial.getNodeCount());
+    for (int j = 0; j < serial.getNodeCount(); ++j) {
+        REQUIRE(parallel.getID(serial.getPage(j)) == j);
+    }
+
+    serial.calculatePageRank(10);
+    parallel.calculatePageRank(10);
+    REQUIRE(parallel.getSortedRanks() == serial.getSortedRanks());
+}
+
+TEST_CASE("Test 16: Parallel CSR build keeps link order and can transpose") {
+    const int nodes = 500;
+    vector<pair<int, int>> edges;
+    for (int i = 0; i < 200000; ++i) {
+        edges.push_back({i * 31 % nodes, i * 17 % 499});
+    }
+
+    CSRGraph serial_in, parallel_in;
+    CSRGraph serial = buildCSR(nodes, edges, 1, &serial_in);
+    CSRGraph parallel = buildCSR(nodes, edges, 4, &parallel_in);
+
+    REQUIRE(parallel.offsets == serial.offsets);
+    REQUIRE(parallel.targets == serial.targets);
+    REQUIRE(parallel_in.offsets == serial_in.offsets);
+    REQUIRE(parallel_in.targets == serial_in.targets);
+
+    // out links as appended to their page's list in order, incoming links in source order
+    vector<vector<int>> out_lists(nodes), in_lists(nodes);
+    for (const auto& edge : edges) {
+        out_lists[edge.first].push_back(edge.second);
+    }
+    for (int u = 0; u < nodes; ++u) {
+        for (int target : out_lists[u]) {
+            in_lists[target].push_back(u);
+        }
+    }
+    for (int u = 0; u < nodes; ++u) {
+        REQUIRE(vector<int>(parallel.targets.begin() + parallel.offsets[u], parallel.targets.begin() + parallel.offsets[u + 1]) == out_lists[u]);
+        REQUIRE(vector<int>(parallel_in.targets.begin() + parallel_in.offsets[u], parallel_in.targets.begin() + parallel_in.offsets[u + 1]) == in_lists[u]);
+    }
+}
+
+TEST_CASE("Test 17: Collapsed duplicate links keep multigraph ranks") {
+    AdjacencyList multigraph, collapsed;
+    for (AdjacencyList* graph : {&multigraph, &collapsed}) {
+        for (int i = 0; i < 5; ++i) {
+            graph->addEdge("home.com", "about.com"); // nav link repeated on every page
+            graph->addEdge("about.com", "home.com");
+        }
+        graph->addEdge("home.com", "blog.com");
+        graph->addEdge("blog.com", "home.com");
+        graph->addEdge("blog.com", "blog.com");
+        graph->addEdge("blog.com", "blog.com");
+        graph->addEdge("blog.com", "about.com");
+        graph->addEdge("about.com", "gone.com");
+        graph->addEdge("about.com", "gone.com");
+    }
+    collapsed.setCollapseDuplicates(true);
+
+    REQUIRE(multigraph.freeze().targets.size() == 17);
+    REQUIRE(collapsed.freeze().targets.size() == 7);
+
+    multigraph.calculatePageRank(15);
+    collapsed.calculatePageRank(15);
+    map<string, double> expected = multigraph.getSortedRanks();
+    for (const auto& page_rank : collapsed.getSortedRanks()) {
+        REQUIRE(page_rank.second == Catch::Approx(expected.at(page_rank.first)));
+    }
+
+    // the other engines read the weights too
+    map<string, double> expected_scc = SCCPageRank(multigraph, 0.85).calculate();
+    map<string, double> expected_ppr = PersonalizedPageRank(multigraph, 0.85).calculateForwardPush("blog.com", 1e-10);
+    map<string, double> scc = SCCPageRank(collapsed, 0.85).calculate();
+    map<string, double> ppr = PersonalizedPageRank(collapsed, 0.85).calculateForwardPush("blog.com", 1e-10);
+    for (const auto& page_rank : expected_scc) {
+        REQUIRE(scc.at(page_rank.first) == Catch::Approx(page_rank.second));
+        REQUIRE(ppr.at(page_rank.first) == Catch::Approx(expected_ppr.at(page_rank.first)).margin(1e-8));
+    }
+
+    // removing a collapsed link drops every copy
+    collapsed.removeEdge("about.com", "gone.com");
+    multigraph.removeEdge("about.com", "gone.com");
+    multigraph.calculatePageRank(15);
+    collapsed.calculatePageRank(15);
+    expected = multigraph.getSortedRanks();
+    for (const auto& page_rank : collapsed.getSortedRanks()) {
+        REQUIRE(page_rank.second == Catch::Approx(expected.at(page_rank.first)));
+    }
+}
+
+TEST_CASE("Test 18: Compressed links decode to the same graph and ranks") {
+    AdjacencyList plain, compressed;
+    for (AdjacencyList* graph : {&plain, &compressed}) {
+        // mostly links to nearby pages, like pages of one site linking each other
+        for (int i = 0; i < 2000; ++i) {
+            for (int k = 1; k <= 12; ++k) {
+                graph->addEdge("page" + std::to_string(i), "page" + std::to_string((i + k * k) % 2000));
+            }
+            graph->addEdge("page" + std::to_string(i), "page" + std::to_string((i * 37 + 5) % 2000));
+            if (i % 3 == 0) {
+                graph->addEdge("page" + std::to_string(i), "page" + std::to_string((i + 1) % 2000));
+            }
+        }
+        graph->addEdge("dangling", "page1");
+        graph->addEdge("page1", "far" + std::to_string(123456));
+    }
+    compressed.setCompressedStorage(true);
+
+    plain.calculatePageRank(20);
+    compressed.calculatePageRank(20);
+    map<string, double> expected = plain.getSortedRanks();
+    for (const auto& page_rank : compressed.getSortedRanks()) {
+        REQUIRE(page_rank.second == Catch::Approx(expected.at(page_rank.first)));
+    }
+
+    // the packed form needs well under 4 bytes a link
+    CSRGraph frozen = plain.freeze();
+    CompressedAdjacency packed;
+    CSRGraph sorted = frozen;
+    packed.encode(sorted);
+    REQUIRE(packed.byteSize() < frozen.targets.size() * sizeof(int) * 3 / 4);
+
+    // and unpacks to the same links per page, sorted
+    packed.decode(sorted);
+    CSRGraph handed_out = compressed.freeze();
+    for (int u = 0; u < frozen.nodes; ++u) {
+        vector<int> links(frozen.targets.begin() + frozen.offsets[u], frozen.targets.begin() + frozen.offsets[u + 1]);
+        std::sort(links.begin(), links.end());
+        REQUIRE(vector<int>(sorted.targets.begin() + sorted.offsets[u], sorted.targets.begin() + sorted.offsets[u + 1]) == links);
+        REQUIRE(vector<int>(handed_out.targets.begin() + handed_out.offsets[u], handed_out.targets.begin() + handed_out.offsets[u + 1]) == links);
+    }
+
+    // the pshufb and the scalar decoder agree, with deltas of every byte length
+    CSRGraph wide;
+    wide.nodes = 2;
+    wide.offsets = {0, 7, 10};
+    wide.targets = {2000000300, 5, 70000, 300, 20000000, 2000000001, 2000000000, 9, 1 << 30, 8};
+    CSRGraph expected_wide = wide;
+    std::sort(expected_wide.targets.begin(), expected_wide.targets.begin() + 7);
+    std::sort(expected_wide.targets.begin() + 7, expected_wide.targets.end());
+    CompressedAdjacency wide_packed;
+    wide_packed.encode(wide);
+    for (bool simd : {false, true}) {
+        wide_packed.setSimdDecoding(simd);
+        packed.setSimdDecoding(simd);
+        REQUIRE(wide_packed.getSimdDecoding() == (simd && CompressedAdjacency::simdSupported()));
+
+        CSRGraph decoded = wide;
+        wide_packed.decode(decoded);
+        REQUIRE(decoded.targets == expected_wide.targets);
+        CSRGraph repacked = frozen;
+        packed.encode(repacked);
+        packed.decode(repacked);
+        REQUIRE(repacked.targets == sorted.targets);
+    }
+
+    // changing a packed graph unpacks it first
+    compressed.removeEdge("page5", "page6");
+    plain.removeEdge("page5", "page6");
+    plain.calculatePageRank(20);
+    compressed.calculatePageRank(20);
+    expected = plain.getSortedRanks();
+    for (const auto& page_rank : compressed.getSortedRanks()) {
+        REQUIRE(page_rank.second == Catch::Approx(expected.at(page_rank.first)));
+    }
+}
+
+TEST_CASE("Test 19: Out of core shards give the same ranks as the in memory graph") {
+    for (double damping : {0.0, 0.85}) {
+        AdjacencyList graph;
+        OutOfCorePageRank sharded("test_out_of_core", 4);
+        for (int i = 0; i < 3000; ++i) {
+            std::string from = "site" + std::to_string(i * 7 % 400) + ".com";
+            std::string to = "site" + std::to_string(i * 13 % 450) + ".com";
+            graph.addEdge(from, to);
+            sharded.addEdge(from, to);
+        }
+        graph.setDampingFactor(damping);
+        sharded.setDampingFactor(damping);
+
+        graph.calculatePageRank(12);
+        map<string, double> expected = graph.getSortedRanks();
+        map<string, double> ranks = sharded.calculatePageRank(12);
+        REQUIRE(sharded.calculatePageRank(0).empty()); // like the in memory graph, no iterations no ranks
+
+        REQUIRE(ranks.size() == expected.size());
+        for (const auto& page_rank : expected) {
+            REQUIRE(ranks.at(page_rank.first) == Catch::Approx(page_rank.second));
+        }
+    }
+
+    // a sort budget far below the names' size numbers the pages through many runs and id buckets on disk
+    AdjacencyList graph;
+    OutOfCorePageRank tight("test_out_of_core_tight", 3, 256);
+    for (int i = 0; i < 3000; ++i) {
+        std::string from = "a-rather-long-page-name-" + std::to_string(i * 7 % 400) + ".com";
+        std::string to = "a-rather-long-page-name-" + std::to_string(i * 13 % 450) + ".com";
+        graph.addEdge(from, to);
+        tight.addEdge(from, to);
+    }
+    graph.addEdge("lonely.com", "");
+    tight.addEdge("lonely.com", "");
+    graph.setDampingFactor(0.85);
+    tight.setDampingFactor(0.85);
+    graph.calculatePageRank(12);
+    map<string, double> expected = graph.getSortedRanks();
+
+    std::vector<std::string> order;
+    REQUIRE(tight.forEachRank(12, [&](const std::string& page, double rank) {
+        order.push_back(page);
+        REQUIRE(rank == Catch::Approx(expected.at(page)));
+    }));
+    REQUIRE(order.size() == expected.size());
+    REQUIRE(std::is_sorted(order.begin(), order.end()));
+
+    // more links after a build are numbered together with the old ones
+    tight.addEdge("lonely.com", "a-rather-long-page-name-0.com");
+    graph.addEdge("lonely.com", "a-rather-long-page-name-0.com");
+    graph.calculatePageRank(12);
+    map<string, double> ranks = tight.calculatePageRank(12);
+    REQUIRE(ranks.size() == expected.size());
+    for (const auto& page_rank : graph.getSortedRanks()) {
+        REQUIRE(ranks.at(page_rank.first) == Catch::Approx(page_rank.second));
+    }
+}
+
+TEST_CASE("Test 20: Memory accounting and budgets") {
+    AdjacencyList graph;
+    for (int i = 0; i < 3000; ++i) {
+        for (int k = 1; k <= 8; ++k) {
+            graph.addEdge("a-page-with-a-long-name-" + std::to_string(i), "a-page-with-a-long-name-" + std::to_string((i + k) % 3000));
+            graph.addEdge("a-page-with-a-long-name-" + std::to_string(i), "a-page-with-a-long-name-" + std::to_string((i + k) % 3000));
+        }
+    }
+    graph.freeze();
+
+    MemoryUsage plain = graph.getMemoryUsage();
+    REQUIRE(plain.interner > 3000 * 32);
+    REQUIRE(plain.names > 3000 * 32);
+    REQUIRE(plain.adjacency >= 48000 * sizeof(int));
+    REQUIRE(plain.ranks == 0);
+    REQUIRE(plain.peak() > plain.resident());
+
+    graph.calculatePageRank(2);
+    REQUIRE(graph.getMemoryUsage().ranks > 0);
+
+    // no budget below the names and ranks themselves can be met
+    REQUIRE_FALSE(graph.fitMemoryBudget(plain.names));
+
+    // a budget between the packed and the plain size switches to the smaller forms
+    AdjacencyList fresh;
+    for (int i = 0; i < 3000; ++i) {
+        for (int k = 1; k <= 8; ++k) {
+            fresh.addEdge("a-page-with-a-long-name-" + std::to_string(i), "a-page-with-a-long-name-" + std::to_string((i + k) % 3000));
+            fresh.addEdge("a-page-with-a-long-name-" + std::to_string(i), "a-page-with-a-long-name-" + std::to_string((i + k) % 3000));
+        }
+    }
+    fresh.calculatePageRank(2);
+    size_t before = fresh.getMemoryUsage().peak();
+    REQUIRE(fresh.fitMemoryBudget(before - 50000));
+    REQUIRE(fresh.getMemoryUsage().peak() <= before - 50000);
+    REQUIRE(fresh.getMemoryUsage().adjacency < plain.adjacency / 2);
+
+    // long names and few links, only front coding the names gets close to what they need frozen
+    AdjacencyList wordy, frozen;
+    for (AdjacencyList* graph : {&wordy, &frozen}) {
+        for (int i = 0; i < 2000; ++i) {
+            graph->addEdge("https://www.example.com/a/rather/long/path/to/an/article/" + std::to_string(i),
+                           "https://www.example.com/a/rather/long/path/to/an/article/" + std::to_string((i * 7 + 1) % 2000));
+        }
+        graph->calculatePageRank(2);
+    }
+    map<string, double> unfrozen_ranks = wordy.getSortedRanks();
+    frozen.freezeNames();
+    REQUIRE_FALSE(frozen.fitMemoryBudget(0)); // leaves the smallest frozen form
+    size_t frozen_peak = frozen.getMemoryUsage().peak();
+    REQUIRE(wordy.fitMemoryBudget(frozen_peak));
+    REQUIRE(wordy.getMemoryUsage().peak() <= frozen_peak);
+    REQUIRE(wordy.getSortedRanks() == unfrozen_ranks);
+}
+
+// forwards to new_delete_resource and keeps count of what passes through
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t outstanding = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        allocations++;
+        outstanding += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        outstanding -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+TEST_CASE("Test 21: Memory resource") {
+    CountingResource counting;
+    map<string, double> expected;
+    {
+        AdjacencyList plain;
+        AdjacencyList pooled(&counting);
+        for (int i = 0; i < 2000; ++i) {
+            string from = "https://www.example.com/section/page-" + std::to_string(i);
+            string to = "https://www.example.com/section/page-" + std::to_string((i * 7 + 3) % 2000);
+            plain.addEdge(from, to);
+            pooled.addEdge(from, to);
+        }
+        pooled.removeNode("https://www.example.com/section/page-5");
+        plain.removeNode("https://www.example.com/section/page-5");
+        plain.setExtrapolation(4);
+        pooled.setExtrapolation(4);
+        plain.calculatePageRank(12);
+        pooled.calculatePageRank(12);
+
+        // same ranks, with names, maps and run temporaries taken from the resource in large blocks
+        REQUIRE(pooled.getSortedRanks() == plain.getSortedRanks());
+        REQUIRE(pooled.getPage(0) == "https://www.example.com/section/page-0");
+        REQUIRE(pooled.getID("https://www.example.com/section/page-9") == plain.getID("https://www.example.com/section/page-9"));
+        REQUIRE(counting.allocations > 0);
+        REQUIRE(counting.allocations < 500);
+
+        // a moved graph keeps its pool, names and ranks, and can still grow
+        AdjacencyList moved(std::move(pooled));
+        REQUIRE(moved.getSortedRanks() == plain.getSortedRanks());
+        REQUIRE(moved.getID("https://www.example.com/section/page-9") == plain.getID("https://www.example.com/section/page-9"));
+        moved.addEdge("https://www.example.com/section/page-0", "https://www.example.com/new");
+        plain.addEdge("https://www.example.com/section/page-0", "https://www.example.com/new");
+        moved.calculatePageRank(12);
+        plain.calculatePageRank(12);
+        REQUIRE(moved.getSortedRanks() == plain.getSortedRanks());
+        REQUIRE(moved.getID("https://www.example.com/new") != -1);
+    }
+
+    // tearing the graph down hands everything back
+    REQUIRE(counting.outstanding == 0);
+}
+
+TEST_CASE("Test 22: Streaming loader") {
+    // uneven lines, blank and one word lines, no newline at the end, and a line past the limit
+    std::string input;
+    for (int i = 0; i < 500; ++i) {
+        input += "page" + std::to_string(i % 97) + std::string(i % 13, ' ') + "\tpage" + std::to_string((i * 31) % 89) + "\n";
+        if (i % 50 == 0) input += "\n  lonely" + std::to_string(i) + "\n";
+    }
+    input += "last-from last-to\nbeyond-from beyond-to";
+    int lines = 0;
+    for (char c : input) lines += c == '\n';
+
+    AdjacencyList serial;
+    std::istringstream serial_in(input);
+    for (int i = 0; i < lines; ++i) {
+        std::string line, from, to;
+        std::getline(serial_in, line);
+        std::istringstream words(line);
+        words >> from >> to;
+        if (!from.empty() && !to.empty()) serial.addEdge(from, to);
+    }
+
+    // tiny blocks so lines straddle blocks and several are in flight at once
+    AdjacencyList streamed;
+    std::istringstream stream_in(input);
+    StreamingLoader loader(3, 40, 2);
+    loader.load(stream_in, lines, [&](const std::string& from, const std::string& to) { streamed.addEdge(from, to); });
+
+    REQUIRE(streamed.getNodeCount() == serial.getNodeCount());
+    for (int j = 0; j < serial.getNodeCount(); ++j) {
+        REQUIRE(streamed.getPage(j) == serial.getPage(j));
+    }
+    REQUIRE(streamed.getID("beyond-from") == -1);
+    REQUIRE(streamed.getID("last-to") != -1);
+    serial.calculatePageRank(5);
+    streamed.calculatePageRank(5);
+    REQUIRE(streamed.getSortedRanks() == serial.getSortedRanks());
+}
+
+TEST_CASE("Test 23: NUMA aware parallel PageRank") {
+    REQUIRE(parseCpuList("0-3,8,10-11") == std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    REQUIRE(parseCpuList("").empty());
+
+    // a fake sysfs with two nodes, and no sysfs at all
+    std::string root = "test_numa_sysfs";
+    std::filesystem::create_directories(root + "/node0");
+    std::filesystem::create_directories(root + "/node1");
+    std::filesystem::create_directories(root + "/possible");
+    std::ofstream(root + "/node0/cpulist") << "0-1\n";
+    std::ofstream(root + "/node1/cpulist") << "2-3\n";
+    std::vector<NumaNode> numa = discoverNumaNodes(root);
+    std::filesystem::remove_all(root);
+    REQUIRE(numa.size() == 2);
+    REQUIRE(numa[1].id == 1);
+    REQUIRE(numa[1].cpus == std::vector<int>{2, 3});
+    REQUIRE(discoverNumaNodes("no/such/directory").size() == 1);
+    REQUIRE(discoverNumaNodes("no/such/directory")[0].cpus.empty());
+
+    // ranges of 512 pages, so four threads really split this graph, with duplicate links and dangling pages
+    AdjacencyList graph;
+    for (int i = 0; i < 3000; ++i) {
+        if (i % 10 == 0) continue;
+        graph.addEdge("p" + std::to_string(i), "p" + std::to_string((i * 13 + 7) % 3000));
+        graph.addEdge("p" + std::to_string(i), "p" + std::to_string((i * 13 + 7) % 3000));
+        graph.addEdge("p" + std::to_string(i), "p" + std::to_string((i + 1) % 3000));
+    }
+
+    // undamped there is no dangling sum, so pulling gives exactly what the serial loop pushes. the first
+    // ranker freezes the graph for the first time, incoming links are in source order all the same
+    map<string, double> first_freeze = ParallelPageRank(graph, 4).calculate(8);
+    graph.calculatePageRank(8);
+    map<string, double> serial = graph.getSortedRanks();
+    REQUIRE(first_freeze == serial);
+    for (int threads : {1, 4}) {
+        ParallelPageRank ranker(graph, threads);
+        REQUIRE(ranker.calculate(8) == serial);
+    }
+
+    graph.setDampingFactor(0.85);
+    graph.calculatePageRank(8);
+    map<string, double> damped = graph.getSortedRanks();
+    ParallelPageRank damped_ranker(graph, 3, 0.85);
+    map<string, double> parallel = damped_ranker.calculate(8);
+    REQUIRE(parallel.size() == damped.size());
+    for (const auto& page_rank : damped) {
+        REQUIRE(std::abs(parallel[page_rank.first] - page_rank.second) < 1e-12);
+    }
+}
+
+TEST_CASE("Test 24: Edge balanced work stealing") {
+    // two portal pages everyone links to, the rest sparse
+    AdjacencyList graph;
+    for (int i = 0; i < 4000; ++i) {
+        graph.addEdge("p" + std::to_string(i), "portal-a");
+        graph.addEdge("p" + std::to_string(i), i % 3 == 0 ? "portal-b" : "p" + std::to_string((i * 7 + 1) % 4000));
+    }
+    graph.addEdge("portal-a", "p0");
+    graph.addEdge("portal-b", "portal-a");
+    graph.setDampingFactor(0.85);
+    graph.calculatePageRank(10);
+    map<string, double> serial = graph.getSortedRanks();
+
+    // big tasks on one thread is the serial order exactly
+    ParallelPageRank single(graph, 1, 0.85);
+    single.setTaskSize(1 << 20);
+    REQUIRE(single.calculate(10) == serial);
+
+    // small tasks split both portals into pieces and leave plenty to steal
+    for (int threads : {2, 5}) {
+        ParallelPageRank ranker(graph, threads, 0.85);
+        ranker.setTaskSize(100);
+        map<string, double> parallel = ranker.calculate(10);
+        REQUIRE(parallel.size() == serial.size());
+        double total = 0.0;
+        for (const auto& page_rank : serial) {
+            REQUIRE(std::abs(parallel[page_rank.first] - page_rank.second) < 1e-12);
+            total += parallel[page_rank.first];
+        }
+        REQUIRE(std::abs(total - 1.0) < 1e-9);
+    }
+}
+
+TEST_CASE("Test 25: Concurrent addEdge") {
+    // eight feeds that share most of their pages, one page exists before ingestion starts
+    auto feed_link = [](int feed, int i) {
+        return std::make_pair("page" + std::to_string((i * 17 + feed) % 1500), "page" + std::to_string((i * 5 + feed * 3) % 1600));
+    };
+
+    AdjacencyList serial, concurrent;
+    serial.addEdge("page0", "page1");
+    concurrent.addEdge("page0", "page1");
+    for (int feed = 0; feed < 8; ++feed) {
+        for (int i = 0; i < 2000; ++i) {
+            serial.addEdge(feed_link(feed, i).first, feed_link(feed, i).second);
+        }
+    }
+
+    concurrent.setConcurrentIngestion(true);
+    std::vector<std::thread> feeds;
+    for (int feed = 0; feed < 8; ++feed) {
+        feeds.emplace_back([&, feed]() {
+            for (int i = 0; i < 2000; ++i) {
+                concurrent.addEdge(feed_link(feed, i).first, feed_link(feed, i).second);
+            }
+        });
+    }
+    for (auto& feed : feeds) feed.join();
+    concurrent.addEdge("lonely", "");
+    concurrent.setConcurrentIngestion(false);
+
+    REQUIRE(concurrent.getNodeCount() == serial.getNodeCount() + 1);
+    REQUIRE(concurrent.getID("page0") == 0);
+    REQUIRE(concurrent.getID("page1") == 1);
+    REQUIRE(concurrent.getID("lonely") != -1);
+    for (int j = 0; j < concurrent.getNodeCount(); ++j) {
+        REQUIRE(concurrent.getID(concurrent.getPage(j)) == j);
+    }
+    REQUIRE(concurrent.freeze().targets.size() == serial.freeze().targets.size());
+
+    // id's come in a different order, so ranks only agree up to rounding
+    serial.addEdge("lonely", "");
+    serial.calculatePageRank(6);
+    concurrent.calculatePageRank(6);
+    map<string, double> expected = serial.getSortedRanks();
+    map<string, double> actual = concurrent.getSortedRanks();
+    REQUIRE(actual.size() == expected.size());
+    for (const auto& page_rank : expected) {
+        REQUIRE(std::abs(actual[page_rank.first] - page_rank.second) < 1e-12);
+    }
+
+    // freezing the names for a prefix query leaves ingestion on, producers keep going against the frozen names
+    AdjacencyList reference, prefixed;
+    prefixed.setConcurrentIngestion(true);
+    for (int round = 0; round < 2; ++round) {
+        feeds.clear();
+        for (int feed = round * 4; feed < round * 4 + 4; ++feed) {
+            for (int i = 0; i < 2000; ++i) {
+                reference.addEdge(feed_link(feed, i).first, feed_link(feed, i).second);
+            }
+            feeds.emplace_back([&, feed]() {
+                for (int i = 0; i < 2000; ++i) {
+                    prefixed.addEdge(feed_link(feed, i).first, feed_link(feed, i).second);
+                }
+            });
+        }
+        for (auto& feed : feeds) feed.join();
+
+        REQUIRE(prefixed.getPrefixRange("page1") == reference.getPrefixRange("page1"));
+        REQUIRE(prefixed.getNodeCount() == reference.getNodeCount());
+    }
+    prefixed.addEdge("page1", "page2");
+    reference.addEdge("page1", "page2");
+    prefixed.setConcurrentIngestion(false);
+
+    // both are numbered alphabetically, only the order of links within a page differs
+    reference.calculatePageRank(6);
+    prefixed.calculatePageRank(6);
+    REQUIRE(prefixed.getNodeCount() == reference.getNodeCount());
+    for (int j = 0; j < reference.getNodeCount(); ++j) {
+        REQUIRE(prefixed.getPage(j) == reference.getPage(j));
+        REQUIRE(std::abs(prefixed.getRank(reference.getPage(j)) - reference.getRank(reference.getPage(j))) < 1e-12);
+    }
+
+    // a thread taking turns between more ingests than it keeps at hand still has one buffer in each
+    std::vector<std::unique_ptr<ConcurrentIngest>> ingests;
+    for (int k = 0; k < 12; ++k) {
+        ingests.emplace_back(new ConcurrentIngest(0));
+    }
+    for (int round = 0; round < 50; ++round) {
+        for (int k = 0; k < 12; ++k) {
+            ingests[k]->addLink(k, round);
+        }
+    }
+    std::thread([&]() { ingests[0]->addLink(0, 50); }).join();
+    for (int k = 0; k < 12; ++k) {
+        REQUIRE(ingests[k]->bufferCount() == (k == 0 ? 2 : 1));
+        vector<pair<int, int>> links = ingests[k]->takeLinks();
+        REQUIRE(links.size() == (k == 0 ? 51 : 50));
+        REQUIRE(links[49] == std::make_pair(k, 49));
+    }
+}
+
+TEST_CASE("Test 26: Rank snapshots") {
+    AdjacencyList graph;
+    REQUIRE(graph.getRankSnapshot() == nullptr);
+    for (int i = 0; i < 2000; ++i) {
+        graph.addEdge("p" + std::to_string(i), "p" + std::to_string((i * 3 + 1) % 2000));
+        graph.addEdge("p" + std::to_string(i), "p" + std::to_string((i * 11 + 5) % 2000));
+        if (i % 7 == 0) graph.addEdge("p" + std::to_string(i), "p0");
+    }
+    graph.setDampingFactor(0.85);
+    graph.calculatePageRank(5);
+
+    std::shared_ptr<const RankSnapshot> first = graph.getRankSnapshot();
+    REQUIRE(first->version == 1);
+    REQUIRE(first->toMap() == graph.getSortedRanks());
+    REQUIRE(first->getRank("p7") == graph.getSortedRanks()["p7"]);
+    REQUIRE(first->getRank("missing") == -1.0);
+
+    // readers keep checking that whatever they see is one whole run while the graph is re-ranked
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> reads{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&]() {
+            long long last_version = 0;
+            while (!done || reads == 0) {
+                std::shared_ptr<const RankSnapshot> snapshot = graph.getRankSnapshot();
+                double total = 0.0;
+                for (double rank : snapshot->ranks) total += rank;
+                if (std::abs(total - 1.0) > 1e-9 || snapshot->version < last_version) torn++;
+                last_version = snapshot->version;
+                reads++;
+            }
+        });
+    }
+    for (int run = 0; run < 20; ++run) {
+        graph.setDampingFactor(run % 2 == 0 ? 0.85 : 0.5);
+        graph.calculatePageRank(4 + run % 3);
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    REQUIRE(torn == 0);
+
+    // old snapshots stay as they were, and share the page list while the pages don't change
+    std::shared_ptr<const RankSnapshot> last = graph.getRankSnapshot();
+    REQUIRE(last->version == 21);
+    REQUIRE(last->pages == first->pages);
+    REQUIRE(first->toMap() != last->toMap());
+
+    graph.removeNode("p3");
+    graph.calculatePageRank(3);
+    REQUIRE(graph.getRankSnapshot()->getRank("p3") == -1.0);
+    REQUIRE(first->getRank("p3") > 0.0);
+    REQUIRE(graph.getRankSnapshot()->toMap() == graph.getSortedRanks());
+
+    // the published names are counted, and frozen names are shared with the snapshot rather than copied
+    MemoryUsage with_maps = graph.getMemoryUsage();
+    REQUIRE(with_maps.names > graph.getRankSnapshot()->pages->byteSize());
+    REQUIRE(with_maps.ranks >= graph.getRankSnapshot()->ranks.size() * sizeof(double));
+    graph.freezeNames();
+    graph.calculatePageRank(3);
+    REQUIRE(graph.getMemoryUsage().names == graph.getRankSnapshot()->pages->byteSize());
+    REQUIRE(graph.getRankSnapshot()->toMap() == graph.getSortedRanks());
+    REQUIRE(graph.getRankSnapshot()->getRank("p4") == graph.getRank("p4"));
+}
+
+// request framing for RankServer, and reading back exactly size bytes
+static void appendRequest(std::string& out, unsigned char op, const std::string& payload) {
+    unsigned int length = static_cast<unsigned int>(payload.size());
+    out += static_cast<char>(op);
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out += payload;
+}
+
+template <class T>
+static std::string encode(const T& value) {
+    return std::string(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static std::string readAnswer(int fd) {
+    auto read_exactly = [fd](size_t size) {
+        std::string bytes(size, '\0');
+        size_t got = 0;
+        while (got < size) {
+            ssize_t n = read(fd, &bytes[got], size - got);
+            if (n <= 0) break;
+            got += n;
+        }
+        return bytes;
+    };
+    unsigned int length = 0;
+    std::memcpy(&length, read_exactly(sizeof(length)).data(), sizeof(length));
+    return read_exactly(length);
+}
+
+TEST_CASE("Test 27: Rank server") {
+    AdjacencyList graph;
+    for (int i = 0; i < 500; ++i) {
+        graph.addEdge("p" + std::to_string(i), "p" + std::to_string((i * 7 + 3) % 500));
+        if (i % 5 == 0) graph.addEdge("p" + std::to_string(i), "hub");
+    }
+    graph.addEdge("hub", "p1");
+    graph.setDampingFactor(0.85);
+    graph.calculatePageRank(3);
+    map<string, double> expected = graph.getSortedRanks();
+
+    std::string path = "test_rank_server.sock";
+    RankServer server(graph, path);
+    REQUIRE(server.start());
+    std::thread serving([&server]() { server.run(); });
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path.c_str());
+    REQUIRE(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+
+    // three requests in one write, answered in order
+    std::string requests;
+    appendRequest(requests, RankServer::LOOKUP, encode(2u) + encode(3u) + "p42" + encode(7u) + "missing");
+    appendRequest(requests, RankServer::TOP, encode(2u));
+    appendRequest(requests, RankServer::VERSION, "");
+    REQUIRE(write(fd, requests.data(), requests.size()) == static_cast<ssize_t>(requests.size()));
+
+    std::string lookup = readAnswer(fd);
+    REQUIRE(lookup.size() == 2 * sizeof(double));
+    double ranks[2];
+    std::memcpy(ranks, lookup.data(), sizeof(ranks));
+    REQUIRE(ranks[0] == expected["p42"]);
+    REQUIRE(ranks[1] == -1.0);
+
+    std::string top = readAnswer(fd);
+    unsigned int count = 0, length = 0;
+    std::memcpy(&count, top.data(), sizeof(count));
+    std::memcpy(&length, top.data() + 4, sizeof(length));
+    REQUIRE(count == 2);
+    REQUIRE(top.substr(8, length) == "hub");
+
+    std::string version = readAnswer(fd);
+    long long served = 0;
+    std::memcpy(&served, version.data(), sizeof(served));
+    REQUIRE(served == 1);
+
+    // recompute in the background, queries keep working, then the new ranks show up
+    std::string recompute;
+    appendRequest(recompute, RankServer::RECOMPUTE, encode(12));
+    REQUIRE(write(fd, recompute.data(), recompute.size()) == static_cast<ssize_t>(recompute.size()));
+    REQUIRE(readAnswer(fd) == std::string(1, '\1'));
+    while (served != 2) {
+        std::string ask;
+        appendRequest(ask, RankServer::VERSION, "");
+        REQUIRE(write(fd, ask.data(), ask.size()) == static_cast<ssize_t>(ask.size()));
+        std::memcpy(&served, readAnswer(fd).data(), sizeof(served));
+    }
+    std::string ask;
+    appendRequest(ask, RankServer::LOOKUP, encode(1u) + encode(3u) + "hub");
+    REQUIRE(write(fd, ask.data(), ask.size()) == static_cast<ssize_t>(ask.size()));
+    std::memcpy(ranks, readAnswer(fd).data(), sizeof(double));
+    REQUIRE(ranks[0] == graph.getSortedRanks()["hub"]);
+    REQUIRE(ranks[0] != expected["hub"]);
+
+    std::string shutdown;
+    appendRequest(shutdown, RankServer::SHUTDOWN, "");
+    REQUIRE(write(fd, shutdown.data(), shutdown.size()) == static_cast<ssize_t>(shutdown.size()));
+    REQUIRE(readAnswer(fd).empty());
+    serving.join();
+    close(fd);
+}
+
+TEST_CASE("Test 28: Rank lookups") {
+    CountingResource counting;
+    AdjacencyList graph(&counting);
+    for (int i = 0; i < 1000; ++i) {
+        graph.addEdge("https://example.com/a-fairly-long-path/" + std::to_string(i), "https://example.com/a-fairly-long-path/" + std::to_string((i * 3 + 1) % 1000));
+    }
+    graph.addEdge("https://example.com/a-fairly-long-path/7", "https://example.com/a-fairly-long-path/8");
+    REQUIRE(graph.getRank("https://example.com/a-fairly-long-path/7") == -1.0);
+    graph.setDampingFactor(0.85);
+    graph.calculatePageRank(6);
+    map<string, double> expected = graph.getSortedRanks();
+
+    std::vector<std::string> urls = {"https://example.com/a-fairly-long-path/7", "nowhere", "https://example.com/a-fairly-long-path/999"};
+    std::vector<double> out(urls.size());
+    size_t allocations = counting.allocations;
+    graph.getRanks(urls.data(), urls.size(), out.data());
+    REQUIRE(counting.allocations == allocations);
+    REQUIRE(out[0] == expected["https://example.com/a-fairly-long-path/7"]);
+    REQUIRE(out[1] == -1.0);
+    REQUIRE(out[2] == expected["https://example.com/a-fairly-long-path/999"]);
+    for (const auto& page_rank : expected) {
+        REQUIRE(graph.getRank(page_rank.first) == page_rank.second);
+    }
+
+    // removed pages disappear, the rest keep their rank through the renumbering, new pages have none yet
+    graph.removeNode("https://example.com/a-fairly-long-path/3");
+    graph.addEdge("https://example.com/new", "https://example.com/a-fairly-long-path/4");
+    graph.freeze();
+    REQUIRE(graph.getRank("https://example.com/a-fairly-long-path/3") == -1.0);
+    REQUIRE(graph.getRank("https://example.com/new") == -1.0);
+    REQUIRE(graph.getRank("https://example.com/a-fairly-long-path/999") == expected["https://example.com/a-fairly-long-path/999"]);
+    REQUIRE(graph.getID(graph.getPage(500)) == 500);
+}
+
+TEST_CASE("Test 29: Front coded names") {
+    std::vector<std::string> words = {"", "a", "ab", "abc", "abd", "b", "b\xff", "b\xff\xff", "c"};
+    for (int i = 0; i < 40; ++i) words.push_back("https://host" + std::to_string(i % 3) + ".com/" + std::to_string(i));
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    FrontCodedDictionary dictionary;
+    dictionary.build(std::vector<std::string_view>(words.begin(), words.end()));
+
+    std::string decoded;
+    for (int i = 0; i < static_cast<int>(words.size()); ++i) {
+        REQUIRE(dictionary.find(words[i]) == i);
+        dictionary.get(i, decoded);
+        REQUIRE(decoded == words[i]);
+    }
+    REQUIRE(dictionary.find("aa") == -1);
+    REQUIRE(dictionary.find("zzz") == -1);
+    auto count_prefix = [&words](const std::string& prefix) {
+        return std::count_if(words.begin(), words.end(), [&](const std::string& w) { return w.compare(0, prefix.size(), prefix) == 0; });
+    };
+    for (std::string prefix : {"", "a", "ab", "b\xff", "https://host1.com/", "https://host1.com/1", "nothing"}) {
+        std::pair<int, int> range = dictionary.prefixRange(prefix);
+        REQUIRE(range.second - range.first == count_prefix(prefix));
+        if (range.second > range.first) REQUIRE(words[range.first].compare(0, prefix.size(), prefix) == 0);
+    }
+
+    // lookups compare against the packed bytes in place, checked against a plain sorted vector
+    std::mt19937 random(29);
+    std::vector<std::string> many;
+    for (int i = 0; i < 3000; ++i) {
+        std::string word;
+        int length = random() % 7;
+        for (int k = 0; k < length; ++k) word += "ab\xff"[random() % 3];
+        many.push_back(word);
+    }
+    std::sort(many.begin(), many.end());
+    many.erase(std::unique(many.begin(), many.end()), many.end());
+    std::vector<std::string> absent;
+    for (int i = 0; i < 3000; ++i) {
+        std::string word;
+        int length = random() % 8;
+        for (int k = 0; k < length; ++k) word += "ab\xff" "c"[random() % 4];
+        if (!std::binary_search(many.begin(), many.end(), word)) absent.push_back(word);
+    }
+    FrontCodedDictionary packed_many;
+    packed_many.build(std::vector<std::string_view>(many.begin(), many.end()));
+    for (int i = 0; i < static_cast<int>(many.size()); ++i) REQUIRE(packed_many.find(many[i]) == i);
+    for (const std::string& word : absent) {
+        REQUIRE(packed_many.find(word) == -1);
+        std::pair<int, int> range = packed_many.prefixRange(word);
+        REQUIRE(range.first == std::lower_bound(many.begin(), many.end(), word) - many.begin());
+    }
+
+    // the same graph with and without frozen names
+    AdjacencyList plain, frozen;
+    for (int i = 0; i < 3000; ++i) {
+        std::string from = "https://www.host" + std::to_string(i % 7) + ".example.com/articles/2024/" + std::to_string(i);
+        std::string to = "https://www.host" + std::to_string((i * 3) % 7) + ".example.com/articles/2024/" + std::to_string((i * 31 + 7) % 3000);
+        plain.addEdge(from, to);
+        frozen.addEdge(from, to);
+    }
+    plain.setDampingFactor(0.85);
+    frozen.setDampingFactor(0.85);
+    frozen.calculatePageRank(2);
+    size_t names_before = frozen.getMemoryUsage().names + frozen.getMemoryUsage().interner;
+    frozen.freezeNames();
+    MemoryUsage after = frozen.getMemoryUsage();
+    REQUIRE(after.names + after.interner < names_before / 4);
+
+    plain.calculatePageRank(8);
+    frozen.calculatePageRank(8);
+    map<string, double> expected = plain.getSortedRanks();
+    map<string, double> actual = frozen.getSortedRanks();
+    REQUIRE(actual.size() == expected.size());
+    for (const auto& page_rank : expected) {
+        REQUIRE(std::abs(actual[page_rank.first] - page_rank.second) < 1e-12);
+        REQUIRE(frozen.getPage(frozen.getID(page_rank.first)) == page_rank.first);
+    }
+
+    // a host is one id range, and its rank can be summed without a scan
+    std::pair<int, int> host = frozen.getPrefixRange("https://www.host3.");
+    REQUIRE(host.second - host.first > 0);
+    double host_rank = 0.0;
+    for (const auto& page_rank : expected) {
+        if (page_rank.first.compare(0, 18, "https://www.host3.") == 0) host_rank += page_rank.second;
+    }
+    REQUIRE(std::abs(frozen.getPrefixRank("https://www.host3.") - host_rank) < 1e-9);
+    REQUIRE(frozen.getPage(host.first).compare(0, 18, "https://www.host3.") == 0);
+
+    // existing pages keep the names frozen, new pages and removals go back to the maps
+    frozen.addEdge("https://www.host0.example.com/articles/2024/0", "https://www.host1.example.com/articles/2024/1");
+    frozen.addEdge("https://brand-new.example.com/", "https://www.host1.example.com/articles/2024/1");
+    frozen.removeNode("https://www.host0.example.com/articles/2024/7");
+    plain.addEdge("https://www.host0.example.com/articles/2024/0", "https://www.host1.example.com/articles/2024/1");
+    plain.addEdge("https://brand-new.example.com/", "https://www.host1.example.com/articles/2024/1");
+    plain.removeNode("https://www.host0.example.com/articles/2024/7");
+    plain.calculatePageRank(4);
+    frozen.calculatePageRank(4);
+    expected = plain.getSortedRanks();
+    actual = frozen.getSortedRanks();
+    REQUIRE(actual.size() == expected.size());
+    for (const auto& page_rank : expected) {
+        REQUIRE(std::abs(actual[page_rank.first] - page_rank.second) < 1e-12);
+    }
+}
+
+TEST_CASE("Test 30: Parallel string sort") {
+    // long shared prefixes, prefixes of each other, empty names, repeats and bytes above 0x7f
+    std::mt19937 random(7);
+    std::vector<std::string> strings;
+    for (int i = 0; i < 60000; ++i) {
+        std::string s = i % 3 == 0 ? "https://www.example.com/" : (i % 3 == 1 ? "https://www.example.org/a/" : "");
+        int length = random() % 6;
+        for (int k = 0; k < length; ++k) s += static_cast<char>("ab/\xe9z"[random() % 5]);
+        strings.push_back(s);
+    }
+    std::vector<std::string_view> names(strings.begin(), strings.end());
+    std::vector<std::string> expected = strings;
+    std::sort(expected.begin(), expected.end());
+
+    for (int threads : {1, 3, 8}) {
+        std::vector<int> ids(strings.size());
+        for (size_t i = 0; i < ids.size(); ++i) ids[i] = static_cast<int>(i);
+        sortByName(ids, names, threads);
+
+        std::vector<int> seen = ids;
+        std::sort(seen.begin(), seen.end());
+        for (size_t i = 0; i < seen.size(); ++i) REQUIRE(seen[i] == static_cast<int>(i));
+        bool same_order = true;
+        for (size_t i = 0; i < ids.size(); ++i) same_order = same_order && strings[ids[i]] == expected[i];
+        REQUIRE(same_order);
+    }
+
+    // the order output walks skips removed pages
+    AdjacencyList graph;
+    graph.setThreads(4);
+    for (int i = 0; i < 20000; ++i) {
+        graph.addEdge("site/" + std::to_string(i * 7919 % 20000), "site/" + std::to_string(i));
+    }
+    graph.removeNode("site/5");
+    std::vector<int> order = graph.getAlphabeticalOrder();
+    REQUIRE(order.size() == 19999);
+    for (size_t i = 1; i < order.size(); ++i) {
+        REQUIRE(graph.getPage(order[i - 1]) < graph.getPage(order[i]));
+    }
+}
+
+TEST_CASE("Test 31: Bit reproducible parallel ranks") {
+    // dangling pages spread over many blocks and a portal with enough links to be split
+    AdjacencyList graph, refrozen;
+    for (AdjacencyList* g : {&graph, &refrozen}) {
+        for (int i = 0; i < 12000; ++i) {
+            if (i % 9 == 0) {
+                g->addEdge("p" + std::to_string(i), "");
+                continue;
+            }
+            g->addEdge("p" + std::to_string(i), "portal");
+            g->addEdge("p" + std::to_string(i), "p" + std::to_string((i * 37 + 11) % 12000));
+        }
+        g->addEdge("portal", "p1");
+    }
+    // an earlier freeze, like the one a memory budget does, changes nothing
+    refrozen.freeze();
+    ParallelPageRank first_freeze(graph, 3, 0.85);
+    first_freeze.setDeterministic(true);
+    ParallelPageRank later_freeze(refrozen, 3, 0.85);
+    later_freeze.setDeterministic(true);
+    REQUIRE(first_freeze.calculate(12) == later_freeze.calculate(12));
+
+    for (int task_size : {0, 300}) {
+        map<string, double> reference;
+        for (int threads : {1, 2, 3, 7}) {
+            ParallelPageRank ranker(graph, threads, 0.85);
+            ranker.setDeterministic(true);
+            ranker.setTaskSize(task_size);
+            map<string, double> ranks = ranker.calculate(12);
+            if (threads == 1) {
+                reference = ranks;
+            } else {
+                REQUIRE(ranks == reference);
+            }
+        }
+
+        double total = 0.0;
+        for (const auto& page_rank : reference) total += page_rank.second;
+        REQUIRE(std::abs(total - 1.0) < 1e-9);
+    }
+}